@@ -0,0 +1,523 @@
+/** @file aabb_tree.hh
+ *  @brief Especificación de la clase AabbTree
+ */
+
+#ifndef AABB_TREE_HH
+#define AABB_TREE_HH
+
+#include "finder_stats.hh"
+#include "utils.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#endif
+
+/** @class AabbTree
+ *  @brief Estructura espacial de Finder basada en un árbol dinámico de cajas (AABB tree).
+ *
+ *  Cada hoja guarda un objeto con su rectángulo exacto y una caja "gruesa" que lo amplía MARGIN
+ *  píxeles por cada lado; cada nodo interno guarda la unión de las cajas de sus dos hijos. Mientras
+ *  un objeto se mueve dentro de su caja gruesa el árbol no cambia (solo se actualiza la copia del
+ *  rectángulo), así que los objetos que oscilan poco no reestructuran nada. Al insertar se baja
+ *  por el hijo que menos aumenta el perímetro y al subir se reequilibra con rotaciones, de forma
+ *  que la altura se mantiene logarítmica.
+ *
+ *  Los nodos viven en un vector y se reutilizan mediante una lista de nodos libres. Las hojas
+ *  guardan el identificador del objeto (el handle que le da Finder).
+ *
+ *  @tparam MARGIN Píxeles que se amplía la caja de cada hoja por cada lado
+ */
+template <int MARGIN = 8>
+class AabbTree {
+ public:
+    /// @brief Información que Finder guarda por objeto: el índice de su hoja.
+    struct Slot {
+        int leaf = -1;
+    };
+
+ private:
+    /// @brief Índice nulo
+    static const int NIL = -1;
+
+    /**
+     * @class Node
+     * @brief Nodo del árbol (hoja si left == NIL)
+     */
+    struct Node {
+        pro2::Rect box;     ///< Caja gruesa (hoja) o unión de las cajas de los hijos
+        pro2::Rect rect;    ///< Rectángulo exacto del objeto (solo hojas)
+        uint32_t   id;      ///< Identificador del objeto (solo hojas)
+        int        parent;  ///< Padre, o siguiente nodo libre si el nodo no se usa
+        int        left;
+        int        right;
+        int        height;  ///< 0 en las hojas
+
+        mutable uint32_t tested;  ///< Veces que las consultas han comprobado la hoja
+    };
+
+    std::vector<Node> nodes_;
+    int               root_ = NIL;
+    int               free_ = NIL;
+
+    /// @brief Tamaño de la pila local de for_each(): el árbol está equilibrado (AVL), así que su
+    /// altura no pasa de 1,44 * log2(n) y la pila, de altura + 1 nodos. Si aun así se llena, la
+    /// pila pasa a un vector.
+    static constexpr int STACK_DEPTH = 64;
+
+    /// @brief Contadores de las consultas y movimientos.
+    mutable FinderStats stats_;
+
+    /**
+     * @brief Unión de dos cajas
+     */
+    static pro2::Rect merge(const pro2::Rect& a, const pro2::Rect& b) {
+        return {std::min(a.left, b.left), std::min(a.top, b.top), std::max(a.right, b.right),
+                std::max(a.bottom, b.bottom)};
+    }
+
+    /**
+     * @brief Perímetro (medio) de una caja, usado como coste de inserción
+     */
+    static long perimeter(const pro2::Rect& r) {
+        return long(r.right - r.left) + long(r.bottom - r.top);
+    }
+
+    /**
+     * @brief Comprueba si la caja outer contiene a inner
+     */
+    static bool contains(const pro2::Rect& outer, const pro2::Rect& inner) {
+        return outer.left <= inner.left && inner.right <= outer.right && outer.top <= inner.top &&
+               inner.bottom <= outer.bottom;
+    }
+
+    bool is_leaf(int i) const {
+        return nodes_[i].left == NIL;
+    }
+
+    /**
+     * @brief Obtiene un nodo libre
+     * \post Devuelve el índice de un nodo sin hijos ni padre
+     */
+    int alloc_node() {
+        int i;
+        if (free_ != NIL) {
+            i = free_;
+            free_ = nodes_[i].parent;
+        } else {
+            i = int(nodes_.size());
+            nodes_.push_back(Node());
+        }
+        nodes_[i].id = 0;
+        nodes_[i].parent = NIL;
+        nodes_[i].left = NIL;
+        nodes_[i].right = NIL;
+        nodes_[i].height = 0;
+        nodes_[i].tested = 0;
+        return i;
+    }
+
+    /**
+     * @brief Devuelve un nodo a la lista de libres
+     */
+    void free_node(int i) {
+        nodes_[i].parent = free_;
+        nodes_[i].height = -1;
+        free_ = i;
+    }
+
+    /**
+     * @brief Sustituye el hijo old_child de parent por new_child (o la raíz si parent es NIL)
+     */
+    void replace_child(int parent, int old_child, int new_child) {
+        if (parent == NIL) {
+            root_ = new_child;
+        } else if (nodes_[parent].left == old_child) {
+            nodes_[parent].left = new_child;
+        } else {
+            nodes_[parent].right = new_child;
+        }
+    }
+
+    /**
+     * @brief Recalcula caja y altura de un nodo interno a partir de sus hijos
+     */
+    void refit(int i) {
+        Node& n = nodes_[i];
+        n.box = merge(nodes_[n.left].box, nodes_[n.right].box);
+        n.height = 1 + std::max(nodes_[n.left].height, nodes_[n.right].height);
+    }
+
+    /**
+     * @brief Hace subir al hijo 'up' del nodo a (rotación) y recoloca sus nietos
+     * \pre up es hijo de a y su altura supera en 2 a la del otro hijo
+     * \post up ocupa el lugar de a, a es hijo de up; devuelve up
+     */
+    int rotate(int a, int up) {
+        const int up_left = nodes_[up].left;
+        const int up_right = nodes_[up].right;
+        const int tall = nodes_[up_left].height > nodes_[up_right].height ? up_left : up_right;
+        const int low = tall == up_left ? up_right : up_left;
+
+        nodes_[up].parent = nodes_[a].parent;
+        replace_child(nodes_[up].parent, a, up);
+        nodes_[a].parent = up;
+
+        // a se queda con el nieto más bajo en lugar de up; up se queda con a y el nieto más alto
+        if (nodes_[a].left == up) {
+            nodes_[a].left = low;
+        } else {
+            nodes_[a].right = low;
+        }
+        nodes_[low].parent = a;
+        nodes_[up].left = a;
+        nodes_[up].right = tall;
+
+        refit(a);
+        refit(up);
+        return up;
+    }
+
+    /**
+     * @brief Reequilibra el subárbol de a si sus hijos difieren en más de 1 de altura
+     * \post Devuelve la nueva raíz del subárbol
+     */
+    int balance(int a) {
+        if (is_leaf(a) || nodes_[a].height < 2) {
+            return a;
+        }
+        const int b = nodes_[a].left;
+        const int c = nodes_[a].right;
+        const int diff = nodes_[c].height - nodes_[b].height;
+        if (diff > 1) {
+            return rotate(a, c);
+        }
+        if (diff < -1) {
+            return rotate(a, b);
+        }
+        return a;
+    }
+
+    /**
+     * @brief Sube desde i hasta la raíz reequilibrando y recalculando cajas
+     */
+    void fix_upwards(int i) {
+        while (i != NIL) {
+            i = balance(i);
+            refit(i);
+            i = nodes_[i].parent;
+        }
+    }
+
+    /**
+     * @brief Inserta una hoja ya inicializada
+     * \post La hoja forma parte del árbol y el árbol está equilibrado
+     */
+    void insert_leaf(int leaf) {
+        if (root_ == NIL) {
+            root_ = leaf;
+            nodes_[leaf].parent = NIL;
+            return;
+        }
+
+        // Se busca el mejor hermano bajando por el hijo que menos aumenta el perímetro
+        const pro2::Rect box = nodes_[leaf].box;
+        int              i = root_;
+        while (!is_leaf(i)) {
+            const long combined = perimeter(merge(nodes_[i].box, box));
+            const long cost = 2 * combined;
+            const long inherit = 2 * (combined - perimeter(nodes_[i].box));
+
+            long child_cost[2];
+            int  child[2] = {nodes_[i].left, nodes_[i].right};
+            for (int k = 0; k < 2; ++k) {
+                const pro2::Rect& cb = nodes_[child[k]].box;
+                child_cost[k] = perimeter(merge(cb, box)) + inherit;
+                if (!is_leaf(child[k])) {
+                    child_cost[k] -= perimeter(cb);
+                }
+            }
+            if (cost < child_cost[0] && cost < child_cost[1]) {
+                break;
+            }
+            i = child_cost[0] < child_cost[1] ? child[0] : child[1];
+        }
+
+        const int sibling = i;
+        const int old_parent = nodes_[sibling].parent;
+        const int new_parent = alloc_node();
+        nodes_[new_parent].parent = old_parent;
+        nodes_[new_parent].left = sibling;
+        nodes_[new_parent].right = leaf;
+        replace_child(old_parent, sibling, new_parent);
+        nodes_[sibling].parent = new_parent;
+        nodes_[leaf].parent = new_parent;
+
+        fix_upwards(new_parent);
+    }
+
+    /**
+     * @brief Quita una hoja del árbol (sin liberarla)
+     * \post La hoja ya no forma parte del árbol y el árbol está equilibrado
+     */
+    void remove_leaf(int leaf) {
+        if (leaf == root_) {
+            root_ = NIL;
+            return;
+        }
+        const int parent = nodes_[leaf].parent;
+        const int grand = nodes_[parent].parent;
+        const int sibling =
+            nodes_[parent].left == leaf ? nodes_[parent].right : nodes_[parent].left;
+
+        replace_child(grand, parent, sibling);
+        nodes_[sibling].parent = grand;
+        free_node(parent);
+        fix_upwards(grand);
+    }
+
+    /**
+     * @brief Construye de arriba abajo un subárbol equilibrado con las hojas leaves[0..n)
+     *        Parte las hojas por la mediana del centro en el eje más largo de su caja.
+     * \pre n > 0
+     * \post Devuelve la raíz del subárbol, cuyo padre es parent
+     */
+    int build_top_down(int *leaves, size_t n, int parent) {
+        if (n == 1) {
+            nodes_[leaves[0]].parent = parent;
+            return leaves[0];
+        }
+        pro2::Rect box = nodes_[leaves[0]].box;
+        for (size_t i = 1; i < n; ++i) {
+            box = merge(box, nodes_[leaves[i]].box);
+        }
+        const bool   split_x = box.right - box.left >= box.bottom - box.top;
+        const size_t mid = n / 2;
+        std::nth_element(leaves, leaves + mid, leaves + n, [this, split_x](int a, int b) {
+            const pro2::Rect& ra = nodes_[a].box;
+            const pro2::Rect& rb = nodes_[b].box;
+            return split_x ? ra.left + ra.right < rb.left + rb.right
+                           : ra.top + ra.bottom < rb.top + rb.bottom;
+        });
+
+        const int node = alloc_node();
+        nodes_[node].parent = parent;
+        const int left = build_top_down(leaves, mid, node);
+        const int right = build_top_down(leaves + mid, n - mid, node);
+        nodes_[node].left = left;
+        nodes_[node].right = right;
+        refit(node);
+        return node;
+    }
+
+ public:
+    /// @brief Constructora de un árbol vacío.
+    AabbTree() {}
+
+    /**
+     * @brief Añade un objeto al árbol
+     * \post id está en una hoja con rect y slot guarda el índice de la hoja
+     */
+    void insert(uint32_t id, const pro2::Rect& rect, Slot& slot) {
+        const int leaf = alloc_node();
+        nodes_[leaf].id = id;
+        nodes_[leaf].rect = rect;
+        nodes_[leaf].box = {rect.left - MARGIN, rect.top - MARGIN, rect.right + MARGIN,
+                            rect.bottom + MARGIN};
+        insert_leaf(leaf);
+        slot.leaf = leaf;
+    }
+
+    /**
+     * @brief Añade de golpe n objetos
+     *        Si el árbol está vacío lo construye de arriba abajo partiendo por la mediana (un árbol
+     *        equilibrado en O(n log n)); si no, inserta las hojas una a una.
+     * @param first Identificador del primer objeto (el de records[i] es first + i)
+     * @param records Registros con miembros rect y slot
+     * \pre Los objetos no están en el árbol
+     * \post Cada objeto está en una hoja y su slot guarda el índice de la hoja
+     */
+    template <typename Record>
+    void bulk_insert(uint32_t first, Record *records, size_t n) {
+        if (n == 0) {
+            return;
+        }
+        nodes_.reserve(nodes_.size() + 2 * n);
+        std::vector<int> leaves(n);
+        for (size_t i = 0; i < n; ++i) {
+            const pro2::Rect& rect = records[i].rect;
+            const int         leaf = alloc_node();
+            nodes_[leaf].id = uint32_t(first + i);
+            nodes_[leaf].rect = rect;
+            nodes_[leaf].box = {rect.left - MARGIN, rect.top - MARGIN, rect.right + MARGIN,
+                                rect.bottom + MARGIN};
+            records[i].slot.leaf = leaf;
+            leaves[i] = leaf;
+        }
+        if (root_ == NIL) {
+            root_ = build_top_down(leaves.data(), n, NIL);
+            return;
+        }
+        for (int leaf : leaves) {
+            insert_leaf(leaf);
+        }
+    }
+
+    /**
+     * @brief Mueve un objeto a su nuevo rectángulo
+     *        Si el nuevo rectángulo cabe en la caja gruesa de la hoja solo se actualiza la copia;
+     *        en otro caso la hoja se vuelve a insertar con una caja gruesa nueva.
+     * \pre slot.leaf es la hoja de id
+     * \post La hoja de id tiene new_rect y su caja gruesa lo contiene
+     */
+    void move(uint32_t, const pro2::Rect&, const pro2::Rect& new_rect, Slot& slot) {
+        Node& leaf = nodes_[slot.leaf];
+        leaf.rect = new_rect;
+        if (contains(leaf.box, new_rect)) {
+            return;
+        }
+        stats_.relinks++;
+        remove_leaf(slot.leaf);
+        nodes_[slot.leaf].box = {new_rect.left - MARGIN, new_rect.top - MARGIN,
+                                 new_rect.right + MARGIN, new_rect.bottom + MARGIN};
+        insert_leaf(slot.leaf);
+    }
+
+    /**
+     * @brief Quita un objeto del árbol
+     * \pre slot.leaf es la hoja de id
+     * \post id ya no está en el árbol y su hoja queda libre
+     */
+    void erase(uint32_t, const pro2::Rect&, Slot& slot) {
+        remove_leaf(slot.leaf);
+        free_node(slot.leaf);
+        slot.leaf = NIL;
+    }
+
+    /**
+     * @brief Visita los objetos que intersectan con rect
+     *        Recorre en profundidad los nodos cuya caja intersecta rect, con una pila local (que
+     *        solo reserva memoria si pasa de STACK_DEPTH nodos), así que visit puede volver a
+     *        consultar el árbol. Las consultas
+     *        actualizan los contadores de stats(): para consultar desde otros hilos hay que usar
+     *        FinderSnapshot.
+     * @param visit Función llamada como visit(uint32_t id, const pro2::Rect& rect_id)
+     * \post Se ha llamado a visit una vez por objeto, en el orden del recorrido del árbol
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, F&& visit) const {
+        stats_.queries++;
+        if (root_ == NIL) {
+            return;
+        }
+        int              local[STACK_DEPTH];
+        std::vector<int> spill;
+        int             *stack = local;
+        int              capacity = STACK_DEPTH;
+        int              top = 0;
+        stack[top++] = root_;
+        while (top > 0) {
+            const Node& n = nodes_[stack[--top]];
+            stats_.cells_touched++;
+            if (!intesec_rect(rect, n.box)) {
+                continue;
+            }
+            if (n.left == NIL) {
+                n.tested++;
+                stats_.tested++;
+                if (intesec_rect(rect, n.rect)) {
+                    stats_.accepted++;
+                    visit(n.id, n.rect);
+                }
+            } else {
+                if (top + 2 > capacity) {
+                    if (spill.empty()) {
+                        spill.assign(local, local + top);
+                    }
+                    spill.resize(2 * capacity);
+                    stack = spill.data();
+                    capacity = int(spill.size());
+                }
+                stack[top++] = n.right;
+                stack[top++] = n.left;
+            }
+        }
+    }
+
+    /**
+     * @brief Contadores de las consultas y movimientos
+     * \post Devuelve queries, cells_touched (nodos recorridos), tested (hojas comprobadas),
+     * accepted y relinks (reinserciones) acumulados
+     */
+    const FinderStats& stats() const {
+        return stats_;
+    }
+
+    /**
+     * @brief Pone a cero los contadores y el coste acumulado de cada hoja
+     */
+    void reset_stats() {
+        stats_ = FinderStats();
+        for (Node& n : nodes_) {
+            n.tested = 0;
+        }
+    }
+
+    /**
+     * @brief Histograma de profundidad de las hojas (cada hoja tiene un solo objeto, así que
+     *        lo que interesa es lo equilibrado que está el árbol)
+     * @param hist Vector donde se deja el histograma (se vacía antes)
+     * \post hist[k] es el número de hojas a profundidad k
+     */
+    void occupancy(std::vector<size_t>& hist) const {
+        hist.clear();
+        if (root_ == NIL) {
+            return;
+        }
+        std::vector<std::pair<int, size_t>> stack = {{root_, 0}};
+        while (!stack.empty()) {
+            const int    i = stack.back().first;
+            const size_t depth = stack.back().second;
+            stack.pop_back();
+            if (is_leaf(i)) {
+                if (hist.size() <= depth) {
+                    hist.resize(depth + 1, 0);
+                }
+                hist[depth]++;
+            } else {
+                stack.push_back({nodes_[i].left, depth + 1});
+                stack.push_back({nodes_[i].right, depth + 1});
+            }
+        }
+    }
+
+    /**
+     * @brief Visita las hojas cuya caja gruesa intersecta con rect (para dibujarlas)
+     * @param visit Función llamada como visit(const pro2::Rect& box, size_t n_objects,
+     * uint64_t tested), con n_objects = 1 y tested el número de veces que se ha comprobado
+     * \post Se ha llamado a visit una vez por hoja, en el orden del recorrido del árbol
+     */
+    template <typename F>
+    void for_each_cell(const pro2::Rect& rect, F&& visit) const {
+        if (root_ == NIL) {
+            return;
+        }
+        std::vector<int> stack = {root_};
+        while (!stack.empty()) {
+            const Node& n = nodes_[stack.back()];
+            stack.pop_back();
+            if (!intesec_rect(rect, n.box)) {
+                continue;
+            }
+            if (n.left == NIL) {
+                visit(n.box, size_t(1), uint64_t(n.tested));
+            } else {
+                stack.push_back(n.right);
+                stack.push_back(n.left);
+            }
+        }
+    }
+};
+
+#endif
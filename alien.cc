@@ -7,6 +7,8 @@
 using namespace std;
 using namespace pro2;
 
+int Alien::frame_ = 0;
+
 const int _ = -1;
 const int B = pro2::black;
 
@@ -25,18 +27,21 @@ const vector<vector<int>> Alien::alien_sprite = {
 // clang-format on
 
 void Alien::paint(pro2::Window& window) const {
-    Pt topleft = Pt({pos_.x - 6, pos_.y - 5});
+    const Pt p = pos();
+    Pt       topleft = Pt({p.x - 6, p.y - 5});
     paint_sprite(window, topleft, alien_sprite, false);
 }
 
-void Alien::update(pro2::Window& window) {
-    int   distance = 20;
-    float angle = window.frame_count();
+Pt Alien::pos() const {
+    int   distance = MOVE_DISTANCE;
+    float angle = frame_;
     float rad = angle / M_PI;
     float vel = 7;
+    Pt    p = center_;
     if (type_mov_ == Y_MOV) {
-        pos_.y = center_.y + distance * sin(rad / vel);
+        p.y = center_.y + distance * sin(rad / vel);
     } else if (type_mov_ == X_MOV) {
-        pos_.x = center_.x + distance * sin(rad / vel);
+        p.x = center_.x + distance * sin(rad / vel);
     }
+    return p;
 }
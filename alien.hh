@@ -6,6 +6,7 @@
 #define ALIEN_HH
 
 #include "platform.hh"
+#include "slot_map.hh"
 #include "window.hh"
 
 #ifndef NO_DIAGRAM
@@ -21,6 +22,13 @@
  */
 enum movement_type { X_MOV, NONE, Y_MOV };
 
+/**
+ *  @enum life_state
+ *  @brief Ciclo de vida de un alien: vivo (ALIVE) o eliminado durante el fotograma actual
+ *  (DYING). Al final del fotograma Game lo destruye y su handle deja de ser válido.
+ */
+enum life_state { ALIVE, DYING };
+
 /** @class Alien
  *  @brief Clase que representa el personaje de Alien
  *
@@ -29,9 +37,10 @@ enum movement_type { X_MOV, NONE, Y_MOV };
  */
 class Alien {
  private:
-    pro2::Pt      pos_;
     pro2::Pt      center_;
     movement_type type_mov_;
+    life_state    state_ = ALIVE;
+    SlotHandle    slot_;
 
  public:
     /** @brief Constructor de Alien
@@ -40,7 +49,7 @@ class Alien {
      *  \pre cierto
      *  \post Crea un alien en pos y movimiento type_mov
      */
-    Alien(pro2::Pt pos, movement_type type_mov) : pos_(pos), center_(pos), type_mov_(type_mov) {}
+    Alien(pro2::Pt pos, movement_type type_mov) : center_(pos), type_mov_(type_mov) {}
 
     Alien() : Alien(pro2::Pt{0, 0}, NONE) {}
 
@@ -51,30 +60,76 @@ class Alien {
      */
     void paint(pro2::Window& window) const;
 
-    /** @brief Actualiza la posición según el tipo de movimiento
-     *  @param window Ventana en la que se dibuja el alien
-     *  \pre window debe estar inicializada
-     *  \post Actualiza pos_ según type_mov_ del parámetro implícito
+    /** @brief Fija el fotograma con el que se calcula la posición de todos los aliens
+     *  @param frame Número de fotograma (Window::frame_count())
+     *  \post pos() y get_rect() de todos los aliens corresponden al fotograma frame
      */
-    void update(pro2::Window& window);
+    static void set_frame(int frame) {
+        frame_ = frame;
+    }
 
     /** @brief Consulta la posición actual
+     *         La posición solo depende del fotograma (set_frame()), así que se calcula cuando se
+     *         pide, sin actualizar los aliens en cada fotograma.
      *  \pre El alien debe estar inicializado
-     *  \post Devuelve pos_ del parámetro implícito
+     *  \post Devuelve la posición del parámetro implícito en el fotograma actual según type_mov_
      */
-    pro2::Pt pos() const {
-        return pos_;
-    }
+    pro2::Pt pos() const;
 
     /** @brief Obtiene el área de colisión
      *  \pre El alien debe estar inicializado
      *  \post Devuelve rectángulo de colisión del parámetro implícito
      */
     pro2::Rect get_rect() const {
-        return {pos_.x - 6, pos_.y - 5, pos_.x + 4, pos_.y + 3};
+        const pro2::Pt p = pos();
+        return {p.x - 6, p.y - 5, p.x + 4, p.y + 3};
+    }
+
+    /** @brief Consulta el estado del ciclo de vida
+     *  \post Devuelve ALIVE o DYING
+     */
+    life_state state() const {
+        return state_;
+    }
+
+    /** @brief Marca el alien como eliminado
+     *  \pre El alien está vivo
+     *  \post El alien está en estado DYING hasta que se destruya al final del fotograma
+     */
+    void kill() {
+        state_ = DYING;
+    }
+
+    /** @brief Handle del alien en el SlotMap que lo guarda */
+    SlotHandle slot() const {
+        return slot_;
+    }
+
+    /** @brief Guarda el handle del alien en el SlotMap que lo guarda
+     *  \post slot() == h
+     */
+    void set_slot(SlotHandle h) {
+        slot_ = h;
     }
 
+    /** @brief Obtiene la zona que puede llegar a ocupar el alien
+     *  \pre El alien debe estar inicializado
+     *  \post Devuelve el rectángulo que contiene todas las posiciones de get_rect() a lo largo
+     *  de su oscilación (MOVE_DISTANCE píxeles a cada lado de su centro)
+     */
+    pro2::Rect get_move_bounds() const {
+        const int dx = type_mov_ == X_MOV ? MOVE_DISTANCE : 0;
+        const int dy = type_mov_ == Y_MOV ? MOVE_DISTANCE : 0;
+        return {center_.x - dx - 6, center_.y - dy - 5, center_.x + dx + 4, center_.y + dy + 3};
+    }
+
+    /// @brief Amplitud en píxeles de la oscilación de los aliens que se mueven.
+    static const int MOVE_DISTANCE = 20;
+
  private:
+    /// @brief Fotograma actual, común a todos los aliens.
+    static int frame_;
+
     static const std::vector<std::vector<int>> alien_sprite;
 };
 
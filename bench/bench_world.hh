@@ -0,0 +1,69 @@
+/** @file bench_world.hh
+ *  @brief Mundo de prueba común a los benchmarks: el mismo que genera Game::Game.
+ */
+
+#ifndef BENCH_WORLD_HH
+#define BENCH_WORLD_HH
+
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "platform.hh"
+
+/** @brief Objeto puntual del mundo (alien, power-up o botiquín) con el movimiento de Alien. */
+struct Body {
+    pro2::Pt pos, center;
+    int      half_w, half_h;
+    int      mov;  // 0 = horizontal, 1 = quieto, 2 = vertical
+
+    pro2::Rect get_rect() const {
+        return {pos.x - half_w, pos.y - half_h, pos.x + half_w, pos.y + half_h};
+    }
+
+    void update(int frame) {
+        float rad = frame / M_PI;
+        if (mov == 2) {
+            pos.y = center.y + 20 * sin(rad / 7);
+        } else if (mov == 0) {
+            pos.x = center.x + 20 * sin(rad / 7);
+        }
+    }
+};
+
+/** @brief Mundo generado igual que en Game::Game. */
+struct World {
+    std::vector<Platform> platforms;
+    std::vector<Body>     aliens, powerups, medkits;
+
+    explicit World(int n_platforms) {
+        srand(42);
+        platforms.push_back(Platform(100, 300, 200, 211));
+        platforms.push_back(Platform(0, 200, 250, 261));
+        platforms.push_back(Platform(250, 400, 150, 161));
+        int last_right = 400;
+        for (int i = 0; i < n_platforms; i++) {
+            int w = 35 + rand() % 150;
+            int left = last_right + 35 + rand() % 30;
+            int random = rand() % 55;
+            platforms.push_back(Platform(left, left + w, 150 + random, 161 + random));
+            last_right = left + w;
+        }
+        for (size_t i = 2; i < platforms.size(); i++) {
+            pro2::Rect r = platforms[i].get_rect();
+            int        w = r.right - r.left;
+            if (rand() % 7 == 0) {
+                pro2::Pt p = {r.left + rand() % w, r.top - 20};
+                powerups.push_back({p, p, 8, 8, 1});
+            }
+            if (rand() % 7 == 0) {
+                pro2::Pt p = {r.left + rand() % w, r.top - 20};
+                medkits.push_back({p, p, 5, 5, 1});
+            }
+            pro2::Pt p = {r.left + rand() % w, r.top - 25 - rand() % 15};
+            aliens.push_back({p, p, 5, 4, rand() % 3});
+        }
+    }
+};
+
+#endif
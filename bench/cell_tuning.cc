@@ -0,0 +1,147 @@
+/** @file cell_tuning.cc
+ *  @brief Ajuste del tamaño de cuadrado de HashGrid para cada tipo de objeto.
+ *
+ *  Reproduce la partida de Game (el mismo mundo con semilla fija y la cámara recorriendo el
+ *  nivel) con un solo tipo de objeto indexado en Finder<T, HashGrid<N>>, para varios tamaños
+ *  de cuadrado N. Igual que Game::update_objects, cada fotograma refresca un VisibleSet con la
+ *  cámara (coste de consulta) y reindexa los objetos visibles con update_many (coste de
+ *  actualización). Con Finder::stats() informa también de los candidatos comprobados y aceptados
+ *  por consulta. Cada medida se repite varias veces y se queda la mejor, para que el orden de
+ *  las pruebas (frecuencia de la CPU, memoria ya reservada) no decida el resultado. Para cada
+ *  tipo se marca el tamaño con menor coste total.
+ *
+ *  Uso: make bench && ./bench/cell_tuning [n_plataformas] [n_fotogramas]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "bench_world.hh"
+#include "finder.hh"
+#include "visible_set.hh"
+
+using namespace std;
+using pro2::Rect;
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * @class Cost
+ * @brief Microsegundos por fotograma de consulta y de actualización
+ */
+struct Cost {
+    double query, update;
+    double tested, accepted;  ///< Candidatos comprobados y aceptados por consulta
+};
+
+/** @brief Mueve una plataforma visible como en Game::update_platforms. */
+static void step(Platform *p, int frame) {
+    if (frame % 64 == 0) {
+        p->start_moving();
+    }
+    p->update();
+}
+
+/** @brief Mueve un alien, power-up o botiquín visible. */
+static void step(Body *b, int frame) {
+    b->update(frame);
+}
+
+/**
+ * @brief Reproduce la partida con los objetos objs indexados en una cuadrícula de N píxeles.
+ * \post Devuelve el coste medio por fotograma de consulta y de actualización
+ */
+template <int N, typename T>
+static Cost replay(vector<T>& objs, int n_frames) {
+    Finder<T, HashGrid<N>> finder;
+    for (T& t : objs) {
+        finder.add(&t);
+    }
+
+    VisibleSet<T>   visibles;
+    Clock::duration query = Clock::duration::zero(), update = query;
+    for (int frame = 0; frame < n_frames; frame++) {
+        Rect              camera = {frame * 4, 0, frame * 4 + 480, 320};
+        Clock::time_point t0 = Clock::now();
+        visibles.refresh(finder, camera);
+        Clock::time_point t1 = Clock::now();
+        for (T *t : visibles) {
+            step(t, frame);
+        }
+        Clock::time_point t2 = Clock::now();
+        finder.update_many(visibles.items());
+        visibles.touch_all(finder.moved());
+        update += Clock::now() - t2;
+        query += t1 - t0;
+    }
+    auto us = [n_frames](Clock::duration d) {
+        return chrono::duration<double, micro>(d).count() / n_frames;
+    };
+    const FinderStats stats = finder.stats();
+    const double      n_queries = stats.queries == 0 ? 1 : double(stats.queries);
+    return {us(query), us(update), stats.tested / n_queries, stats.accepted / n_queries};
+}
+
+/// @brief Repeticiones de cada medida
+const int REPEATS = 5;
+
+/** @brief Se queda con la medida más rápida de las dos. */
+static Cost best_of(const Cost& a, const Cost& b) {
+    return a.query + a.update <= b.query + b.update ? a : b;
+}
+
+/**
+ * @brief Mide un tamaño de cuadrado para los cuatro tipos de objeto
+ * \post costs[k] contiene el mejor coste del tipo k con cuadrados de N píxeles
+ */
+template <int N>
+static void measure(int n_platforms, int n_frames, Cost costs[4]) {
+    for (int r = 0; r < REPEATS; r++) {
+        World w0(n_platforms), w1(n_platforms), w2(n_platforms), w3(n_platforms);
+        Cost  run[4] = {replay<N>(w0.platforms, n_frames), replay<N>(w1.aliens, n_frames),
+                        replay<N>(w2.powerups, n_frames), replay<N>(w3.medkits, n_frames)};
+        for (int k = 0; k < 4; k++) {
+            costs[k] = r == 0 ? run[k] : best_of(costs[k], run[k]);
+        }
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int n_platforms = argc > 1 ? atoi(argv[1]) : 35000;
+    int n_frames = argc > 2 ? atoi(argv[2]) : 20000;
+    printf("%d plataformas, %d fotogramas (us/fotograma: consulta + actualización)\n", n_platforms,
+           n_frames);
+
+    const int   N_SIZES = 8;
+    const int   sizes[N_SIZES] = {16, 32, 64, 100, 128, 256, 512, 1024};
+    Cost        costs[N_SIZES][4];
+    const char *kinds[4] = {"plataformas", "aliens", "power-ups", "botiquines"};
+    measure<16>(n_platforms, n_frames, costs[0]);
+    measure<32>(n_platforms, n_frames, costs[1]);
+    measure<64>(n_platforms, n_frames, costs[2]);
+    measure<100>(n_platforms, n_frames, costs[3]);
+    measure<128>(n_platforms, n_frames, costs[4]);
+    measure<256>(n_platforms, n_frames, costs[5]);
+    measure<512>(n_platforms, n_frames, costs[6]);
+    measure<1024>(n_platforms, n_frames, costs[7]);
+
+    for (int k = 0; k < 4; k++) {
+        int best = 0;
+        for (int s = 1; s < N_SIZES; s++) {
+            if (costs[s][k].query + costs[s][k].update <
+                costs[best][k].query + costs[best][k].update) {
+                best = s;
+            }
+        }
+        printf("\n%s\n", kinds[k]);
+        for (int s = 0; s < N_SIZES; s++) {
+            printf("  N = %4d   consulta %6.3f   actualización %6.3f   total %6.3f   "
+                   "candidatos/consulta %7.2f (aceptados %5.2f)%s\n",
+                   sizes[s], costs[s][k].query, costs[s][k].update,
+                   costs[s][k].query + costs[s][k].update, costs[s][k].tested,
+                   costs[s][k].accepted, s == best ? "   <- mejor" : "");
+        }
+    }
+}
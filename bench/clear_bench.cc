@@ -0,0 +1,178 @@
+/** @file clear_bench.cc
+ *  @brief Benchmark del buffer de Window: coste de Window::clear y de pintar y mostrar un
+ *         fotograma.
+ *
+ *  Usa un buffer del tamaño del de la ventana del juego (WIDTH x HEIGHT con ZOOM, como en
+ *  main.cc) y lo rellena una vez por fotograma, alternando dos colores como el cielo normal y el
+ *  del power-up. Compara la versión original (new uint32_t[] y un bucle de un píxel por
+ *  iteración) con el buffer alineado de alloc_pixels y cada versión de fill_pixels, incluida la
+ *  que elige Window::clear en esta CPU.
+ *
+ *  El bucle original se compila con las opciones de los benchmarks (-O2), con las que hace una
+ *  escritura de 4 bytes por píxel (como en la compilación por defecto del juego, sin
+ *  optimizar). "alineado + escalar" es el mismo bucle en pixel_buffer.cc: con make MODE=release
+ *  (-O3) el compilador ya lo vectoriza. Las medidas (stream) escriben sin pasar por la caché, lo
+ *  que Window::clear solo hace a partir de STREAM_MIN_BYTES.
+ *
+ *  La segunda parte mide un fotograma entero (clear, SPRITES sprites de 16x16 pintados con
+ *  set_pixel y mostrar) con el Window original, que pinta cada píxel zoom x zoom veces en el
+ *  buffer de la ventana, y con el actual, que pinta en un buffer sin zoom y lo amplía una sola
+ *  vez en next_frame (upscale_pixels).
+ *
+ *  Uso: make bench MODE=release && ./bench/clear_bench [n_fotogramas] [zoom]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "pixel_buffer.hh"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+const int WIDTH = 480, HEIGHT = 320;
+
+/// @brief Repeticiones de cada medida (se queda la mejor)
+const int REPEATS = 3;
+
+/// @brief Colores que se alternan entre fotogramas (cielo y cielo con el power-up).
+const uint32_t COLORS[2] = {0x5C94FC, 0xFFA07A};
+
+/**
+ * @brief Window::clear original
+ * \post Los n píxeles de dst valen color
+ */
+static void old_clear(uint32_t *dst, size_t n, uint32_t color) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = color;
+    }
+}
+
+/// @brief Sprites pintados en cada fotograma de la segunda parte
+const int SPRITES = 200;
+
+/**
+ * @brief Mide una función que pinta un fotograma
+ * \post Devuelve los microsegundos por fotograma (el mejor de REPEATS)
+ */
+template <typename Frame>
+static double time_frames(int frames, Frame frame) {
+    double best = 1e30;
+    for (int r = 0; r < REPEATS; r++) {
+        Clock::time_point t0 = Clock::now();
+        for (int f = 0; f < frames; f++) {
+            frame(f);
+        }
+        best = min(best, chrono::duration<double, micro>(Clock::now() - t0).count() / frames);
+    }
+    return best;
+}
+
+/**
+ * @brief Mide una versión de clear sobre un buffer
+ * \post Escribe los microsegundos por fotograma y el ancho de banda
+ */
+template <typename Fill>
+static void run(const char *name, uint32_t *pixels, size_t n, int frames, Fill fill) {
+    uint64_t     check = 0;
+    const double us = time_frames(frames, [&](int f) {
+        fill(pixels, n, COLORS[f & 1]);
+        check += pixels[(f * 7919) % n];
+    });
+    const double gbps = n * sizeof(uint32_t) / (us * 1e3);
+    printf("%-26s %8.1f us/fotograma   %6.2f GB/s   (%llu)\n", name, us, gbps,
+           (unsigned long long)(check % 1000));
+}
+
+/**
+ * @brief Pinta SPRITES sprites de 16x16 repartidos por la pantalla (algunos cortados por los
+ *        bordes)
+ */
+template <typename SetPixel>
+static void paint_sprites(int f, SetPixel set_pixel) {
+    for (int s = 0; s < SPRITES; s++) {
+        const int x0 = (s * 97 + f) % (WIDTH + 16) - 16;
+        const int y0 = (s * 53) % (HEIGHT + 16) - 16;
+        for (int y = 0; y < 16; y++) {
+            for (int x = 0; x < 16; x++) {
+                set_pixel(x0 + x, y0 + y, uint32_t(s * 16 + x));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Mide un fotograma con el Window original y con el actual
+ * \post Escribe los microsegundos por fotograma de cada uno
+ */
+static void run_frames(int frames, int zoom) {
+    const int    pw = WIDTH * zoom, ph = HEIGHT * zoom;
+    uint32_t    *pixels = pro2::alloc_pixels(size_t(pw) * ph);
+    uint32_t    *back = pro2::alloc_pixels(size_t(WIDTH) * HEIGHT);
+    const double old_us = time_frames(frames, [&](int f) {
+        pro2::fill_pixels(pixels, size_t(pw) * ph, COLORS[f & 1]);
+        paint_sprites(f, [&](int x, int y, uint32_t color) {
+            for (int i = 0; i < zoom; i++) {
+                for (int j = 0; j < zoom; j++) {
+                    const int _i = x * zoom + i;
+                    const int _j = y * zoom + j;
+                    if (_i >= 0 && _i < pw && _j >= 0 && _j < ph) {
+                        pixels[_j * pw + _i] = color;
+                    }
+                }
+            }
+        });
+    });
+    const double new_us = time_frames(frames, [&](int f) {
+        pro2::fill_pixels(back, size_t(WIDTH) * HEIGHT, COLORS[f & 1]);
+        paint_sprites(f, [&](int x, int y, uint32_t color) {
+            if (x >= 0 && x < WIDTH && y >= 0 && y < HEIGHT) {
+                back[y * WIDTH + x] = color;
+            }
+        });
+        pro2::upscale_pixels(back, WIDTH, HEIGHT, pixels, zoom);
+    });
+    printf("fotograma con zoom %d: original %8.1f us   buffer sin zoom + ampliar %8.1f us\n", zoom,
+           old_us, new_us);
+    pro2::free_pixels(back);
+    pro2::free_pixels(pixels);
+}
+
+int main(int argc, char *argv[]) {
+    int          frames = argc > 1 ? atoi(argv[1]) : 2000;
+    int          zoom = argc > 2 ? atoi(argv[2]) : 2;
+    const size_t n = size_t(WIDTH) * HEIGHT * zoom * zoom;
+    printf("%dx%d con zoom %d: %zu pixeles (%zu KB), %d fotogramas, fill_pixels = %s\n", WIDTH,
+           HEIGHT, zoom, n, n * sizeof(uint32_t) / 1024, frames, pro2::fill_pixels_impl());
+
+    uint32_t *plain = new uint32_t[n];
+    run("original (new[] + bucle)", plain, n, frames, old_clear);
+    delete[] plain;
+
+    uint32_t *aligned = pro2::alloc_pixels(n);
+    run("alineado + escalar", aligned, n, frames, pro2::fill_pixels_scalar);
+#ifdef PRO2_PIXELS_X86
+    for (bool stream : {false, true}) {
+        run(stream ? "alineado + sse2 (stream)" : "alineado + sse2", aligned, n, frames,
+            [stream](uint32_t *dst, size_t n, uint32_t color) {
+                pro2::fill_pixels_sse2(dst, n, color, stream);
+            });
+        if (pro2::cpu_has_avx2()) {
+            run(stream ? "alineado + avx2 (stream)" : "alineado + avx2", aligned, n, frames,
+                [stream](uint32_t *dst, size_t n, uint32_t color) {
+                    pro2::fill_pixels_avx2(dst, n, color, stream);
+                });
+        }
+    }
+#endif
+    run("clear (buffer con zoom)", aligned, n, frames, pro2::fill_pixels);
+    pro2::free_pixels(aligned);
+
+    printf("\n%d sprites de 16x16 por fotograma\n", SPRITES);
+    for (int z = 1; z <= max(zoom, 4); z++) {
+        run_frames(frames, z);
+    }
+}
@@ -0,0 +1,371 @@
+/** @file finder_bench.cc
+ *  @brief Benchmark de Finder frente a la implementación original con std::map/std::set.
+ *
+ *  Genera el mismo mundo que Game::Game (plataformas, aliens, power-ups y botiquines) con una
+ *  semilla fija, y mide el tiempo de construcción y el de una partida simulada en la que la
+ *  cámara recorre el nivel consultando y actualizando los objetos visibles en cada fotograma.
+ *  Después repite la partida por separado para cada tipo de objeto con cada estructura espacial
+ *  de Finder (y StripFinder), para poder elegir la mejor estructura para cada tipo.
+ *
+ *  Por último mide el arranque de un mundo muy grande indexando los objetos uno a uno o con
+ *  Finder::bulk_build().
+ *
+ *  Uso: make bench && ./bench/finder_bench [n_plataformas] [n_fotogramas] [n_arranque]
+ */
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <vector>
+
+#include "aabb_tree.hh"
+#include "bench_world.hh"
+#include "finder.hh"
+#include "loose_quadtree.hh"
+#include "platform.hh"
+#include "strip_finder.hh"
+
+using namespace std;
+using pro2::Pt;
+using pro2::Rect;
+
+template <typename T>
+using GridFinder = Finder<T, HashGrid<>>;
+template <typename T>
+using QuadtreeFinder = Finder<T, LooseQuadtree<>>;
+template <typename T>
+using TreeFinder = Finder<T, AabbTree<>>;
+
+/** @class MapFinder
+ *  @brief Implementación original de Finder (std::map de cuadrados a std::set), como referencia.
+ */
+template <typename T>
+class MapFinder {
+    const int                   N = 100;
+    std::map<T *, Rect>         objects_;
+    std::map<Pt, std::set<T *>> pos_map_;
+
+    Pt n_pt(const Pt& p) const {
+        return {p.x / N * N, p.y / N * N};
+    }
+
+    vector<Pt> vect_pts(const Rect& rect) const {
+        vector<Pt> pts;
+        Pt         topleft = n_pt({rect.left, rect.top});
+        Pt         bottomright = n_pt({rect.right, rect.bottom});
+        for (int x = topleft.x; x <= bottomright.x; x += N) {
+            for (int y = topleft.y; y <= bottomright.y; y += N) {
+                pts.push_back({x, y});
+            }
+        }
+        return pts;
+    }
+
+ public:
+    void add(T *t) {
+        Rect rect = t->get_rect();
+        objects_[t] = rect;
+        for (const Pt& p : vect_pts(rect)) {
+            pos_map_[p].insert(t);
+        }
+    }
+
+    void update(T *t) {
+        auto it = objects_.find(t);
+        if (it == objects_.end()) {
+            return;
+        }
+        vector<Pt> old_points = vect_pts(it->second);
+        it->second = t->get_rect();
+        vector<Pt> new_points = vect_pts(it->second);
+        for (size_t i = 0; i < old_points.size(); ++i) {
+            bool found = false;
+            for (size_t j = 0; j < new_points.size() && !found; ++j) {
+                found = old_points[i].x == new_points[j].x && old_points[i].y == new_points[j].y;
+            }
+            if (!found) {
+                pos_map_[old_points[i]].erase(t);
+                if (pos_map_[old_points[i]].empty()) {
+                    pos_map_.erase(old_points[i]);
+                }
+            }
+        }
+        for (size_t i = 0; i < new_points.size(); ++i) {
+            bool found = false;
+            for (size_t j = 0; j < old_points.size() && !found; ++j) {
+                found = new_points[i].x == old_points[j].x && new_points[i].y == old_points[j].y;
+            }
+            if (!found) {
+                pos_map_[new_points[i]].insert(t);
+            }
+        }
+    }
+
+    void remove(T *t) {
+        auto it = objects_.find(t);
+        if (it == objects_.end()) {
+            return;
+        }
+        for (const Pt& p : vect_pts(it->second)) {
+            pos_map_[p].erase(t);
+            if (pos_map_[p].empty()) {
+                pos_map_.erase(p);
+            }
+        }
+        objects_.erase(it);
+    }
+
+    set<T *> query(Rect rect) {
+        set<T *> result;
+        for (const Pt& p : vect_pts(rect)) {
+            auto it = pos_map_.find(p);
+            if (it != pos_map_.end()) {
+                for (T *t : it->second) {
+                    if (intesec_rect(rect, objects_.find(t)->second)) {
+                        result.insert(t);
+                    }
+                }
+            }
+        }
+        return result;
+    }
+};
+
+/** @brief Consulta con la API de cada implementación: conjunto nuevo o vector reutilizado. */
+template <typename T>
+static void visible(MapFinder<T>& finder, const Rect& rect, vector<T *>& out) {
+    set<T *> result = finder.query(rect);
+    out.assign(result.begin(), result.end());
+}
+
+template <typename T, typename B>
+static void visible(Finder<T, B>& finder, const Rect& rect, vector<T *>& out) {
+    finder.query(rect, out);
+}
+
+template <typename T>
+static void visible(StripFinder<T>& finder, const Rect& rect, vector<T *>& out) {
+    finder.query(rect, out);
+}
+
+/** @brief Reindexa los objetos visibles: uno a uno o con update_many. */
+template <typename T>
+static void refresh(MapFinder<T>& finder, const vector<T *>& objs) {
+    for (T *t : objs) {
+        finder.update(t);
+    }
+}
+
+template <typename T, typename B>
+static void refresh(Finder<T, B>& finder, const vector<T *>& objs) {
+    finder.update_many(objs);
+}
+
+template <typename T>
+static void refresh(StripFinder<T>& finder, const vector<T *>& objs) {
+    finder.update_many(objs);
+}
+
+/** @brief Indexa todos los objetos: uno a uno, con StripFinder::build() o Finder::bulk_build(). */
+template <typename F, typename T>
+static void fill(F& finder, const vector<T *>& objs) {
+    for (T *t : objs) {
+        finder.add(t);
+    }
+}
+
+template <typename T>
+static void fill(StripFinder<T>& finder, const vector<T *>& objs) {
+    finder.build(objs);
+}
+
+template <typename T, typename B>
+static void fill(Finder<T, B>& finder, const vector<T *>& objs) {
+    finder.bulk_build(objs);
+}
+
+typedef chrono::steady_clock Clock;
+
+static double ms_since(Clock::time_point t0) {
+    return chrono::duration<double, milli>(Clock::now() - t0).count();
+}
+
+/** @brief Construye los cuatro índices y simula n_frames fotogramas de partida. */
+template <template <typename> class F>
+static void run(const char *name, int n_platforms, int n_frames) {
+    World             world(n_platforms);
+    F<Platform>       platform_finder;
+    F<Body>           alien_finder, powerup_finder, medkit_finder;
+    Clock::time_point t0 = Clock::now();
+    for (Platform& p : world.platforms) {
+        platform_finder.add(&p);
+    }
+    for (Body& b : world.aliens) {
+        alien_finder.add(&b);
+    }
+    for (Body& b : world.powerups) {
+        powerup_finder.add(&b);
+    }
+    for (Body& b : world.medkits) {
+        medkit_finder.add(&b);
+    }
+    double build_ms = ms_since(t0);
+
+    size_t             n_visible = 0;
+    vector<Platform *> platforms;
+    vector<Body *>     bodies;
+    t0 = Clock::now();
+    for (int frame = 0; frame < n_frames; frame++) {
+        Rect camera = {frame * 4, 0, frame * 4 + 480, 320};
+        visible(platform_finder, camera, platforms);
+        for (Platform *p : platforms) {
+            if (frame % 64 == 0) {
+                p->start_moving();
+            }
+            p->update();
+            n_visible++;
+        }
+        refresh(platform_finder, platforms);
+        visible(alien_finder, camera, bodies);
+        for (Body *b : bodies) {
+            b->update(frame);
+            n_visible++;
+        }
+        refresh(alien_finder, bodies);
+        visible(powerup_finder, camera, bodies);
+        n_visible += bodies.size();
+        refresh(powerup_finder, bodies);
+        visible(medkit_finder, camera, bodies);
+        n_visible += bodies.size();
+        refresh(medkit_finder, bodies);
+    }
+    double frames_ms = ms_since(t0);
+
+    printf("%-10s build %8.2f ms   frames %8.2f ms (%6.2f us/frame, %zu visibles)\n", name,
+           build_ms, frames_ms, 1000 * frames_ms / n_frames, n_visible);
+}
+
+/** @brief Mueve una plataforma visible como en Game::update_platforms. */
+static void step(Platform *p, int frame) {
+    if (frame % 64 == 0) {
+        p->start_moving();
+    }
+    p->update();
+}
+
+/** @brief Mueve un alien, power-up o botiquín visible. */
+static void step(Body *b, int frame) {
+    b->update(frame);
+}
+
+/**
+ * @brief Repite la partida con un solo tipo de objeto indexado en F.
+ * \post Devuelve los microsegundos por fotograma de consulta + movimiento + reindexado
+ */
+template <template <typename> class F, typename T>
+static double replay(vector<T>& objs, int n_frames) {
+    vector<T *> all;
+    for (T& t : objs) {
+        all.push_back(&t);
+    }
+    F<T> finder;
+    fill(finder, all);
+
+    vector<T *>       visibles;
+    Clock::time_point t0 = Clock::now();
+    for (int frame = 0; frame < n_frames; frame++) {
+        Rect camera = {frame * 4, 0, frame * 4 + 480, 320};
+        visible(finder, camera, visibles);
+        for (T *t : visibles) {
+            step(t, frame);
+        }
+        refresh(finder, visibles);
+    }
+    return 1000 * ms_since(t0) / n_frames;
+}
+
+/** @brief Fila de la tabla: la partida de cada tipo de objeto con la estructura F. */
+template <template <typename> class F>
+static void run_kinds(const char *name, int n_platforms, int n_frames) {
+    World  platforms(n_platforms), aliens(n_platforms), powerups(n_platforms),
+        medkits(n_platforms);
+    double t_platforms = replay<F>(platforms.platforms, n_frames);
+    double t_aliens = replay<F>(aliens.aliens, n_frames);
+    double t_powerups = replay<F>(powerups.powerups, n_frames);
+    double t_medkits = replay<F>(medkits.medkits, n_frames);
+    printf("%-14s %10.2f %10.2f %10.2f %10.2f\n", name, t_platforms, t_aliens, t_powerups,
+           t_medkits);
+}
+
+/**
+ * @brief Arranque de Game::Game: plataformas en StripFinder y aliens, power-ups y botiquines en
+ *        F, indexados objeto a objeto con add() o de golpe con bulk_build().
+ */
+template <template <typename> class F>
+static void run_startup(const char *name, int n_platforms) {
+    World              world(n_platforms);
+    vector<Platform *> platforms;
+    vector<Body *>     aliens, powerups, medkits;
+    for (Platform& p : world.platforms) {
+        platforms.push_back(&p);
+    }
+    for (Body& b : world.aliens) {
+        aliens.push_back(&b);
+    }
+    for (Body& b : world.powerups) {
+        powerups.push_back(&b);
+    }
+    for (Body& b : world.medkits) {
+        medkits.push_back(&b);
+    }
+
+    double add_ms, bulk_ms;
+    {
+        Clock::time_point     t0 = Clock::now();
+        StripFinder<Platform> platform_finder;
+        F<Body>               alien_finder, powerup_finder, medkit_finder;
+        platform_finder.build(platforms);
+        for (Body *b : aliens) {
+            alien_finder.add(b);
+        }
+        for (Body *b : powerups) {
+            powerup_finder.add(b);
+        }
+        for (Body *b : medkits) {
+            medkit_finder.add(b);
+        }
+        add_ms = ms_since(t0);
+    }
+    {
+        Clock::time_point     t0 = Clock::now();
+        StripFinder<Platform> platform_finder;
+        F<Body>               alien_finder, powerup_finder, medkit_finder;
+        platform_finder.build(platforms);
+        alien_finder.bulk_build(aliens);
+        powerup_finder.bulk_build(powerups);
+        medkit_finder.bulk_build(medkits);
+        bulk_ms = ms_since(t0);
+    }
+    printf("%-14s add %8.1f ms   bulk_build %8.1f ms\n", name, add_ms, bulk_ms);
+}
+
+int main(int argc, char *argv[]) {
+    int n_platforms = argc > 1 ? atoi(argv[1]) : 35000;
+    int n_frames = argc > 2 ? atoi(argv[2]) : 20000;
+    int n_startup = argc > 3 ? atoi(argv[3]) : 2000000;
+    printf("%d plataformas, %d fotogramas\n", n_platforms, n_frames);
+    run<MapFinder>("std::map", n_platforms, n_frames);
+    run<GridFinder>("Finder", n_platforms, n_frames);
+    printf("\nus/fotograma por tipo   plataformas     aliens  power-ups botiquines\n");
+    run_kinds<MapFinder>("std::map", n_platforms, n_frames);
+    run_kinds<GridFinder>("HashGrid", n_platforms, n_frames);
+    run_kinds<QuadtreeFinder>("LooseQuadtree", n_platforms, n_frames);
+    run_kinds<TreeFinder>("AabbTree", n_platforms, n_frames);
+    run_kinds<StripFinder>("StripFinder", n_platforms, n_frames);
+    printf("\narranque con %d plataformas\n", n_startup);
+    run_startup<GridFinder>("HashGrid", n_startup);
+    run_startup<QuadtreeFinder>("LooseQuadtree", n_startup);
+    run_startup<TreeFinder>("AabbTree", n_startup);
+}
@@ -0,0 +1,122 @@
+/** @file list_bench.cc
+ *  @brief Benchmark de List con cada política de memoria y de comprobaciones.
+ *
+ *  Construye una lista con tantos elementos como aliens tiene el mundo de Game, la recorre
+ *  entera muchas veces (como un bucle de actualización de entidades) y después borra un
+ *  elemento de cada tres y la vacía. Compara la versión original (HeapAlloc con comprobaciones)
+ *  con SlabPool, con y sin comprobaciones de los iteradores (ListChecked / ListUnchecked, que es
+ *  la política por defecto al compilar con make MODE=release).
+ *
+ *  El efecto de las comprobaciones se ve comparando las dos medidas de SlabPool, cuya
+ *  disposición en memoria es siempre la misma. Los nodos de HeapAlloc salen del heap general:
+ *  después de la primera medida reutilizan memoria liberada en otro orden (como en una partida
+ *  larga con altas y bajas), así que su recorrido depende también del estado del heap.
+ *
+ *  Uso: make bench MODE=release && ./bench/list_bench [n_elementos] [n_recorridos]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+
+#include "list.hh"
+#include "utils.hh"
+
+using namespace std;
+
+typedef chrono::steady_clock Clock;
+
+/**
+ * @class Entity
+ * @brief Elemento del tamaño de un Alien
+ */
+struct Entity {
+    pro2::Pt pos, center;
+    int      type;
+
+    Entity() : Entity(0, 0, 0) {}
+
+    Entity(int x, int y, int t) : pos{x, y}, center{x, y}, type(t) {}
+};
+
+/** @brief Milisegundos desde t0. */
+static double ms_since(Clock::time_point t0) {
+    return chrono::duration<double, milli>(Clock::now() - t0).count();
+}
+
+/**
+ * @class Times
+ * @brief Milisegundos de cada fase
+ */
+struct Times {
+    double build, traverse, erase, clear;
+};
+
+/// @brief Repeticiones de cada medida (se queda la mejor de cada fase)
+const int REPEATS = 3;
+
+/**
+ * @brief Mide una vez una combinación de políticas
+ * \post Devuelve los tiempos de construcción, recorrido, borrado y vaciado
+ */
+template <template <typename> class Alloc, typename Checks>
+static Times measure(int n, int passes, long& sum) {
+    List<Entity, Alloc, Checks> list;
+
+    Clock::time_point t0 = Clock::now();
+    for (int i = 0; i < n; i++) {
+        list.emplace_back(i * 7, i % 55, i % 3);
+    }
+    const double build = ms_since(t0);
+
+    t0 = Clock::now();
+    for (int p = 0; p < passes; p++) {
+        for (auto it = list.begin(); it != list.end(); ++it) {
+            Entity& e = *it;
+            e.pos.x = e.center.x + (p & 7);
+            sum += e.pos.x;
+        }
+    }
+    const double traverse = ms_since(t0);
+
+    t0 = Clock::now();
+    int i = 0;
+    for (auto it = list.begin(); it != list.end(); i++) {
+        it = i % 3 == 0 ? list.erase(it) : ++it;
+    }
+    const double erase = ms_since(t0);
+
+    t0 = Clock::now();
+    list.clear();
+    const double clear = ms_since(t0);
+    return {build, traverse, erase, clear};
+}
+
+/**
+ * @brief Mide una combinación de políticas REPEATS veces
+ * \post Escribe el mejor tiempo de cada fase
+ */
+template <template <typename> class Alloc, typename Checks>
+static void run(const char *name, int n, int passes) {
+    long  sum = 0;
+    Times best = measure<Alloc, Checks>(n, passes, sum);
+    for (int r = 1; r < REPEATS; r++) {
+        Times t = measure<Alloc, Checks>(n, passes, sum);
+        best = {min(best.build, t.build), min(best.traverse, t.traverse),
+                min(best.erase, t.erase), min(best.clear, t.clear)};
+    }
+    printf("%-22s construir %7.2f ms   recorrer %8.2f ms   borrar %6.2f ms   vaciar %6.2f ms"
+           "   (%ld)\n",
+           name, best.build, best.traverse, best.erase, best.clear, sum % 1000);
+}
+
+int main(int argc, char *argv[]) {
+    int n = argc > 1 ? atoi(argv[1]) : 35000;
+    int passes = argc > 2 ? atoi(argv[2]) : 2000;
+    printf("%d elementos, %d recorridos\n", n, passes);
+    run<SlabPool, ListChecked>("SlabPool + checked", n, passes);
+    run<SlabPool, ListUnchecked>("SlabPool + unchecked", n, passes);
+    run<HeapAlloc, ListChecked>("HeapAlloc + checked", n, passes);
+    run<HeapAlloc, ListUnchecked>("HeapAlloc + unchecked", n, passes);
+}
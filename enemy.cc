@@ -48,14 +48,10 @@ void Enemy::update(pro2::Window& window, Mario& mario1) {
         current_cooldown_ = fire_cooldown_;
     }
 
-    for (auto it = bullets_.begin(); it != bullets_.end();) {
-        (*it).x -= BULLET_SPEED;
-        if ((*it).x < 0) {
-            it = bullets_.erase(it);
-        } else {
-            ++it;
-        }
+    for (pro2::Pt& bullet : bullets_) {
+        bullet.x -= BULLET_SPEED;
     }
+    bullets_.remove_if([](const pro2::Pt& bullet) { return bullet.x < 0; });
 }
 
 void Enemy::paint(pro2::Window& window) const {
@@ -29,9 +29,11 @@ class Enemy {
     int              fire_cooldown_;
     int              current_cooldown_;
     List<pro2::Pt>   bullets_;
-    static const int BULLET_SPEED = 5;
 
  public:
+    /// @brief Píxeles que avanza cada bala hacia la izquierda en cada fotograma.
+    static const int BULLET_SPEED = 5;
+
     /**
      * @brief Constructor del enemigo
      * @param initial_y Posición vertical inicial
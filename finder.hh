@@ -5,193 +5,608 @@
 #ifndef FINDER_HH
 #define FINDER_HH
 
+#include "finder_snapshot.hh"
+#include "finder_stats.hh"
+#include "flat_map.hh"
+#include "hash_grid.hh"
+#include "sweep.hh"
 #include "utils.hh"
 
 #ifndef NO_DIAGRAM
-#include <map>
+#include <algorithm>
+#include <cstdint>
+#include <memory>
 #include <set>
 #include <vector>
 #endif
 
+/**
+ * @brief k objetos más cercanos según la estructura espacial (versión para estructuras con
+ *        nearest(), como HashGrid, que recorre sus cuadrados por anillos)
+ * \post best contiene, como montículo de máximos, las parejas (distancia al cuadrado, id) de los
+ * min(k, n) objetos más cercanos a p
+ */
+template <typename Backend>
+auto backend_nearest(const Backend& backend, pro2::Pt p, size_t k, size_t,
+                     std::vector<std::pair<int64_t, uint32_t>>& best, int)
+    -> decltype(backend.nearest(p, k, best)) {
+    return backend.nearest(p, k, best);
+}
+
+/**
+ * @brief k objetos más cercanos según la estructura espacial (versión genérica)
+ *        Consulta con for_each cuadrados centrados en p cada vez del doble de lado hasta que
+ *        dentro del círculo inscrito hay k objetos o el cuadrado ya contiene los n objetos.
+ * @param n Número de objetos de la estructura
+ * \post best contiene, como montículo de máximos, las parejas (distancia al cuadrado, id) de los
+ * min(k, n) objetos más cercanos a p
+ */
+template <typename Backend>
+void backend_nearest(const Backend& backend, pro2::Pt p, size_t k, size_t n,
+                     std::vector<std::pair<int64_t, uint32_t>>& best, long) {
+    best.clear();
+    k = std::min(k, n);
+    if (k == 0) {
+        return;
+    }
+    for (int r = 64;; r *= 2) {
+        const int64_t r2 = int64_t(r) * r;
+        size_t        seen = 0;
+        best.clear();
+        backend.for_each({p.x - r, p.y - r, p.x + r, p.y + r},
+                         [&](uint32_t id, const pro2::Rect& rect) {
+                             seen++;
+                             const int64_t d = dist2_pt_rect(p, rect);
+                             if (d <= r2) {
+                                 best.push_back({d, id});
+                             }
+                         });
+        if (best.size() >= k || seen == n) {
+            break;
+        }
+    }
+    std::sort(best.begin(), best.end());
+    best.resize(std::min(best.size(), k));
+    std::make_heap(best.begin(), best.end());
+}
+
 /** @class Finder
- *  @brief Clase que gestiona qué objetos están dentro de la pantalla mediante una cuadrícula.
- *         Organiza los objetos en una cuadrícula para saber qué objetos están en una zona
- *         sin tener que revisarlos todos.
+ *  @brief Clase que gestiona qué objetos están dentro de la pantalla mediante una estructura
+ *         espacial. Organiza los objetos para saber qué objetos están en una zona sin tener que
+ *         revisarlos todos.
+ *
+ *  Al añadir un objeto Finder le da un handle: un índice pequeño y denso en el vector de
+ *  registros (puntero, rectángulo y datos de la estructura espacial). Toda la información interna,
+ *  incluida la estructura espacial, usa el handle y no el puntero, así que actualizar o quitar un
+ *  objeto por su handle es un acceso directo al vector, y si el objeto cambia de dirección (por
+ *  ejemplo porque el contenedor que lo guarda se redimensiona) basta con relocate(). Los handles
+ *  de los objetos eliminados se reutilizan. Las operaciones que reciben un puntero siguen
+ *  disponibles y buscan el handle en una tabla de hash.
+ *
+ *  Finder delega la organización espacial en una estructura intercambiable (`Backend`). Todas
+ *  ofrecen la misma interfaz, en términos del identificador (handle) de cada objeto:
+ *  - `struct Slot`: información que Finder guarda por objeto para la estructura.
+ *  - `insert(id, rect, slot)`, `move(id, old_rect, new_rect, slot)` y `erase(id, rect, slot)`.
+ *  - `bulk_insert(first, records, n)`: inserta de golpe los registros records[0..n) (con miembros
+ *    rect y slot), cuyos identificadores son first, first + 1...
+ *  - `for_each(rect, visit)`: llama a visit(id, rect_id) una vez por objeto que intersecta rect.
+ *    Las consultas de barrido (sweep() y segment()) se construyen sobre esta misma operación.
+ *  - `stats()`, `reset_stats()`, `occupancy(hist)` y `for_each_cell(rect, visit)`: estadísticas
+ *    de uso (ver FinderStats) y recorrido de sus cuadrados o nodos para dibujarlos.
+ *  - Opcional: `nearest(p, k, best)`, búsqueda propia de los k más cercanos (si no la tiene,
+ *    Finder::nearest usa consultas for_each cada vez más grandes).
+ *
+ *  Para consultar desde otros hilos, publish() crea una versión inmutable (FinderSnapshot) que
+ *  comparte con la anterior las páginas sin cambios, y snapshot() devuelve la última publicada.
+ *
+ *  Estructuras disponibles:
+ *  - `HashGrid<N>` (hash_grid.hh): cuadrícula uniforme (por defecto).
+ *  - `LooseQuadtree<BASE>` (loose_quadtree.hh): quadtree holgado, para tamaños muy variados.
+ *  - `AabbTree<MARGIN>` (aabb_tree.hh): árbol dinámico de cajas con márgenes, para grupos densos.
+ *
  *  @tparam T Tipo de objeto (debe tener método get_rect())
+ *  @tparam Backend Estructura espacial
  */
-template <typename T>
+template <typename T, typename Backend = HashGrid<>>
 class Finder {
+ public:
+    /// @brief Identificador de un objeto dentro de Finder.
+    typedef uint32_t Handle;
+
+    /// @brief Resultado de sweep() y segment().
+    typedef SweepHit<T> Hit;
+
+    /// @brief Versión inmutable publicada por publish().
+    typedef FinderSnapshot<T> Snapshot;
+
  private:
-    /// @brief Constante que define el tamaño de los cuadrados de la cuadrícula
-    const int N = 100;
+    /**
+     * @class Record
+     * @brief Datos guardados por cada objeto registrado (obj == nullptr si el handle está libre)
+     */
+    struct Record {
+        T                     *obj = nullptr;
+        pro2::Rect             rect;
+        typename Backend::Slot slot;
+    };
+
+    /// @brief Registros indexados por handle.
+    std::vector<Record> records_;
+
+    /// @brief Handles de objetos eliminados, para reutilizarlos.
+    std::vector<Handle> free_;
+
+    /// @brief Tabla que contiene el puntero de un objeto como clave y su handle.
+    FlatMap<T *, Handle> handles_;
+
+    /// @brief Estructura espacial.
+    Backend backend_;
 
-    /// @brief Mapa que contiene el puntero de un objeto como clave y su rectángulo.
-    std::map<T *, pro2::Rect> objects_;
+    /// @brief Vector auxiliar reutilizado por query() para ordenar los resultados sin reservar
+    /// memoria en cada consulta.
+    std::vector<std::pair<pro2::Rect, T *>> scratch_;
 
-    /// @brief Mapa que contiene el punto que marca cada cuadrado como clave y un set de los objetos
-    /// que pertenecen a este cuadrado
-    std::map<pro2::Pt, std::set<T *>> pos_map_;
+    /// @brief Objetos que cambiaron de rectángulo en el último update_many().
+    std::vector<T *> moved_;
+
+    /// @brief Vector auxiliar reutilizado por nearest() y within(): parejas (distancia al
+    /// cuadrado, handle).
+    std::vector<std::pair<int64_t, Handle>> near_;
+
+    /// @brief Contadores de altas, bajas y actualizaciones (el resto los cuenta backend_).
+    FinderStats churn_;
+
+    /// @brief Última versión publicada. Otros hilos la leen, así que solo se lee y se sustituye
+    /// con std::atomic_load y std::atomic_store.
+    std::shared_ptr<const Snapshot> published_;
+
+    /// @brief Páginas de Snapshot con cambios desde la última publicación (con repetidos).
+    std::vector<uint64_t> dirty_;
 
     /**
-     *  @brief Calcula qué cuadrados intersectan con un rectángulo
-     *  @param rect Rectángulo de consulta
-     *  \pre Cierto
-     *  \post Vector con las esquinas inferiores izquierdas de los cuadrados con los que
-     * intersecciona rect
+     * @brief Anota como cambiadas las páginas que toca un rectángulo
+     * \post Si ya se ha publicado alguna versión, las páginas de rect están en dirty_ (antes de
+     * la primera publicación no hace falta: se publican todas)
      */
-    pro2::Pt n_pt(const pro2::Pt& p) const {
-        return {p.x / N * N, p.y / N * N};
+    void mark_dirty(const pro2::Rect& rect) {
+        if (published_->version() == 0) {
+            return;
+        }
+        const pro2::Rect pages = Snapshot::page_range(rect);
+        for (int px = pages.left; px <= pages.right; ++px) {
+            for (int py = pages.top; py <= pages.bottom; ++py) {
+                dirty_.push_back(Snapshot::page_key(px, py));
+            }
+        }
     }
 
     /**
-     *  @brief Comprueba intersección entre rectángulos
-     *  @param rect1 Primer rectángulo
-     *  @param rect2 Segundo rectángulo
-     *  \pre Ambos rectángulos deben estar inicializados
-     *  \post Devuelve true si hay intersección, false en caso contrario
+     * @brief Actualiza un objeto ya localizado
+     * \post Devuelve true si el rectángulo ha cambiado (y en ese caso se ha movido en backend_)
      */
-    std::vector<pro2::Pt> vect_pts(const pro2::Rect& rect) const {
-        std::vector<pro2::Pt> pts;
-        pro2::Pt              topleft = n_pt({rect.left, rect.top});
-        pro2::Pt              bottomright = n_pt({rect.right, rect.bottom});
-
-        for (int x = topleft.x; x <= bottomright.x; x += N) {
-            for (int y = topleft.y; y <= bottomright.y; y += N) {
-                pts.push_back({x, y});
-            }
+    bool update_record(Handle h, Record& record) {
+        pro2::Rect new_rect = record.obj->get_rect();
+        churn_.updates++;
+        if (new_rect == record.rect) {
+            return false;
         }
-        return pts;
+        churn_.moves++;
+        pro2::Rect old_rect = record.rect;
+        record.rect = new_rect;
+        backend_.move(h, old_rect, new_rect, record.slot);
+        mark_dirty(old_rect);
+        mark_dirty(new_rect);
+        return true;
+    }
+
+    /**
+     * @brief Registro de un objeto dado por handle o por puntero
+     * \post Devuelve el registro, o nullptr si el objeto no está en Finder
+     */
+    Record *record_of(Handle h) {
+        return h < records_.size() && records_[h].obj != nullptr ? &records_[h] : nullptr;
+    }
+
+    Record *record_of(T *t) {
+        const Handle *h = handles_.find(t);
+        return h != nullptr ? &records_[*h] : nullptr;
     }
 
  public:
     /// @brief Constructora de Finder.
-    Finder(){};
+    Finder() : published_(std::make_shared<const Snapshot>()){};
 
     /**
      *  @brief Añade un nuevo objeto en Finder
-     *         Primero obtiene su rectángulo, lo guarda en objects_, luego determina
-     *         todos los cuadrados de la cuadrícula que intersectan con ese rectángulo,
-     *         añadiendo el objeto a cada uno de esos cuadrados en pos_map_.
+     *         Obtiene su rectángulo, lo guarda en el registro de un handle libre y lo inserta en
+     * la estructura espacial.
      * @param t Puntero al objeto a añadir
-     * \pre t debe tener método get_rect()
-     * \post Se añade el objeto en todos los cuadrados que intersectan con su rectángulo
+     * \pre t debe tener método get_rect() y no estar ya en Finder
+     * \post Se añade el objeto según su rectángulo y se devuelve su handle
      */
-    void add(T *t) {
-        pro2::Rect rect = t->get_rect();
-        objects_[t] = rect;
+    Handle add(T *t) {
+        Handle h;
+        if (!free_.empty()) {
+            h = free_.back();
+            free_.pop_back();
+        } else {
+            h = Handle(records_.size());
+            records_.push_back(Record());
+        }
+        Record& record = records_[h];
+        record.obj = t;
+        record.rect = t->get_rect();
+        handles_[t] = h;
+        backend_.insert(h, record.rect, record.slot);
+        mark_dirty(record.rect);
+        churn_.adds++;
+        return h;
+    }
 
-        std::vector<pro2::Pt> mat_pts = vect_pts(rect);
-        for (int i = 0; i < mat_pts.size(); ++i) {
-            pos_map_[mat_pts[i]].insert(t);
+    /**
+     *  @brief Añade de golpe muchos objetos (por ejemplo todo el mundo al generarlo)
+     *         Reserva de una vez los registros y la tabla de handles, y la estructura espacial
+     * construye su índice en una sola pasada (en la cuadrícula: calcula todas las parejas cuadrado
+     * - objeto, las ordena y crea cada cuadrado con su tamaño exacto).
+     *  @param objs Rango con size() (por ejemplo un std::vector) de punteros a objetos
+     *  \pre Cada objeto de objs debe tener método get_rect() y no estar ya en Finder
+     *  \post Todos los objetos de objs están en Finder, con handles consecutivos en el orden de
+     * objs (los handles libres no se reutilizan)
+     */
+    template <typename Range>
+    void bulk_build(const Range& objs) {
+        const Handle first = Handle(records_.size());
+        records_.reserve(records_.size() + objs.size());
+        handles_.reserve(handles_.size() + objs.size());
+        for (T *t : objs) {
+            handles_[t] = Handle(records_.size());
+            records_.push_back(Record());
+            records_.back().obj = t;
+            records_.back().rect = t->get_rect();
         }
+        backend_.bulk_insert(first, records_.data() + first, records_.size() - first);
+        for (size_t i = first; i < records_.size(); ++i) {
+            mark_dirty(records_[i].rect);
+        }
+        churn_.adds += records_.size() - first;
+    }
+
+    /**
+     *  @brief Consulta el handle de un objeto
+     *  \post Devuelve true y deja en h el handle de t si t está en Finder
+     */
+    bool handle(T *t, Handle& h) const {
+        const Handle *found = handles_.find(t);
+        if (found == nullptr) {
+            return false;
+        }
+        h = *found;
+        return true;
+    }
+
+    /**
+     *  @brief Objeto de un handle
+     *  \pre h es un handle de Finder
+     *  \post Devuelve el puntero al objeto registrado con h
+     */
+    T *get(Handle h) const {
+        return records_[h].obj;
+    }
+
+    /**
+     *  @brief Cambia la dirección de un objeto sin tocar la estructura espacial
+     *         Se usa cuando el contenedor que guarda los objetos los mueve de sitio (por ejemplo
+     * un std::vector que crece o se compacta).
+     *  @param h Handle del objeto
+     *  @param t Nueva dirección del objeto
+     *  \pre h es un handle de Finder y t tiene el mismo rectángulo que el objeto registrado
+     *  \post h se refiere a t
+     */
+    void relocate(Handle h, T *t) {
+        Record& record = records_[h];
+        handles_.erase(record.obj);
+        record.obj = t;
+        handles_[t] = h;
+        mark_dirty(record.rect);
     }
 
     /**
      *  @brief Actualiza la posición de un objeto existente en Finder
-     *         Compara los cuadrados antiguos y nuevos que intersectan con su rectángulo,
-     * eliminándolo de los cuadrados que ya no intersecta y añadiéndolo a los nuevos cuadrados que
-     * ahora intersecta.
-     *  @param t Puntero al objeto a actualizar
-     *  \pre t debe tener método get_rect()
-     *  \post Actualiza el objeto t según su nuevo rectángulo
-     */
-    void update(T *t) {
-        auto obj_it = objects_.find(t);
-        if (obj_it == objects_.end()) {
+     *         Si el rectángulo no ha cambiado vuelve enseguida; en otro caso la estructura
+     * espacial solo aplica la diferencia (en la cuadrícula, si sigue tocando los mismos cuadrados
+     * solo se actualiza la copia del rectángulo). Con un handle no hace falta buscar el objeto.
+     *  @param t Handle o puntero del objeto a actualizar
+     *  \pre El objeto debe tener método get_rect()
+     *  \post Actualiza el objeto según su nuevo rectángulo. Devuelve true si el rectángulo ha
+     * cambiado y false si no ha cambiado o el objeto no está en Finder
+     */
+    bool update(Handle h) {
+        Record *record = record_of(h);
+        return record != nullptr && update_record(h, *record);
+    }
+
+    bool update(T *t) {
+        const Handle *h = handles_.find(t);
+        return h != nullptr && update_record(*h, records_[*h]);
+    }
+
+    /**
+     *  @brief Actualiza de golpe un conjunto de objetos
+     *         Hace una sola pasada en la que descarta los objetos cuyo rectángulo no ha cambiado
+     * (el caso habitual de plataformas y botiquines quietos) y aplica la diferencia de los demás.
+     * Los objetos que se han movido quedan anotados en moved().
+     *  @param objs Rango (por ejemplo un std::vector) de handles o de punteros a objetos de Finder
+     *  \pre Cada objeto de objs debe tener método get_rect()
+     *  \post Todos los objetos de objs están actualizados; moved() contiene, en el orden de objs,
+     * los que han cambiado de rectángulo
+     */
+    template <typename Range>
+    void update_many(const Range& objs) {
+        moved_.clear();
+        for (const auto& t : objs) {
+            Record *record = record_of(t);
+            if (record != nullptr && update_record(Handle(record - records_.data()), *record)) {
+                moved_.push_back(record->obj);
+            }
+        }
+    }
+
+    /**
+     *  @brief Objetos que se movieron en la última llamada a update_many
+     *  \post Devuelve los objetos cuyo rectángulo cambió en el último update_many
+     */
+    const std::vector<T *>& moved() const {
+        return moved_;
+    }
+
+    /**
+     *  @brief Elimina un objeto de Finder
+     *         Quita el objeto de la estructura espacial y deja su handle libre para reutilizarlo.
+     *  @param t Handle o puntero del objeto a eliminar
+     *  \pre Cierto
+     *  \post El objeto se ha eliminado de Finder
+     */
+    void remove(Handle h) {
+        Record *record = record_of(h);
+        if (record == nullptr) {
             return;
         }
+        backend_.erase(h, record->rect, record->slot);
+        mark_dirty(record->rect);
+        handles_.erase(record->obj);
+        record->obj = nullptr;
+        free_.push_back(h);
+        churn_.removes++;
+    }
 
-        pro2::Rect new_rect = t->get_rect();
-        pro2::Rect old_rect = obj_it->second;
-        obj_it->second = new_rect;
+    void remove(T *t) {
+        const Handle *h = handles_.find(t);
+        if (h != nullptr) {
+            remove(*h);
+        }
+    }
 
-        std::vector<pro2::Pt> old_points = vect_pts(old_rect);
-        std::vector<pro2::Pt> new_points = vect_pts(new_rect);
+    /**
+     *  @brief Visita los objetos con rectángulo total o parcial dentro de 'rect'.
+     *  @param rect El rectángulo de búsqueda
+     *  @param visit Función llamada como visit(T *obj, const pro2::Rect& obj_rect)
+     *  \post Se ha llamado a visit una vez por objeto, sin construir ningún conjunto (el orden es
+     * determinista pero depende de la estructura espacial)
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, F&& visit) const {
+        backend_.for_each(rect, [this, &visit](uint32_t h, const pro2::Rect& r) {
+            visit(records_[h].obj, r);
+        });
+    }
 
-        for (int i = 0; i < old_points.size(); ++i) {
-            bool found = false;
-            int  j = 0;
-            while (j < new_points.size() && !found) {
-                if (old_points[i].x == new_points[j].x && old_points[i].y == new_points[j].y) {
-                    found = true;
-                }
-                ++j;
-            }
-            if (!found) {
-                pos_map_[old_points[i]].erase(t);
-                if (pos_map_[old_points[i]].empty()) {
-                    pos_map_.erase(old_points[i]);
+    /**
+     *  @brief Barrido de un rectángulo en movimiento (colisión continua)
+     *         Solo se comprueban los objetos de la estructura espacial cercanos al recorrido, de
+     * forma que un objeto rápido no atraviesa a otro entre dos fotogramas y el coste no depende de
+     * cuántos objetos hay en pantalla.
+     *  @param box Rectángulo al empezar el movimiento
+     *  @param delta Desplazamiento de box
+     *  @param out Vector donde se dejan los resultados (se vacía antes)
+     *  \post out contiene los objetos que toca box a lo largo del movimiento, ordenados por el
+     * instante del primer contacto (ver sweep_index)
+     */
+    void sweep(const pro2::Rect& box, pro2::Pt delta, std::vector<Hit>& out) const {
+        sweep_index(*this, box, delta, out);
+    }
+
+    /**
+     *  @brief Objetos que toca el segmento de 'from' a 'to' (un rayo acotado)
+     *  @param out Vector donde se dejan los resultados (se vacía antes)
+     *  \post out contiene los objetos que toca el segmento ordenados por el instante del primer
+     * contacto (0 en from y 1 en to)
+     */
+    void segment(pro2::Pt from, pro2::Pt to, std::vector<Hit>& out) const {
+        sweep({from.x, from.y, from.x, from.y}, {to.x - from.x, to.y - from.y}, out);
+    }
+
+    /**
+     *  @brief Publica una versión inmutable del contenido actual para consultas desde otros hilos
+     *         La nueva versión comparte con la anterior todas las páginas sin cambios y solo
+     * rehace, con una consulta a la estructura espacial, las que han tocado los objetos
+     * añadidos, movidos o eliminados desde la última publicación (la primera vez, todas). Solo
+     * la debe llamar el hilo que modifica Finder, por ejemplo una vez por fotograma después de
+     * actualizar los objetos. Las consultas de publish() cuentan en stats().
+     *  \post snapshot() devuelve la nueva versión, que refleja el estado actual de Finder
+     */
+    std::shared_ptr<const Snapshot> publish() {
+        const std::shared_ptr<const Snapshot> prev = std::atomic_load(&published_);
+        std::shared_ptr<Snapshot>             next = std::make_shared<Snapshot>(prev->next());
+        if (prev->version() == 0) {
+            dirty_.clear();
+            for (const Record& record : records_) {
+                if (record.obj != nullptr) {
+                    const pro2::Rect pages = Snapshot::page_range(record.rect);
+                    for (int px = pages.left; px <= pages.right; ++px) {
+                        for (int py = pages.top; py <= pages.bottom; ++py) {
+                            dirty_.push_back(Snapshot::page_key(px, py));
+                        }
+                    }
                 }
             }
         }
+        std::sort(dirty_.begin(), dirty_.end());
+        dirty_.erase(std::unique(dirty_.begin(), dirty_.end()), dirty_.end());
+        for (uint64_t key : dirty_) {
+            typename Snapshot::Page page;
+            backend_.for_each(Snapshot::page_rect(key), [this, &page](uint32_t h,
+                                                                      const pro2::Rect& r) {
+                page.push_back({records_[h].obj, r});
+            });
+            next->set_page(key, std::move(page));
+        }
+        dirty_.clear();
+        std::shared_ptr<const Snapshot> published = next;
+        std::atomic_store(&published_, published);
+        return published;
+    }
 
-        for (int i = 0; i < new_points.size(); ++i) {
-            bool found = false;
-            int  j = 0;
-            while (j < old_points.size() && !found) {
-                if (new_points[i].x == old_points[j].x && new_points[i].y == old_points[j].y) {
-                    found = true;
-                }
-                ++j;
+    /**
+     *  @brief Última versión publicada
+     *         Se puede llamar desde cualquier hilo: la versión devuelta no cambia nunca y se
+     * mantiene viva mientras alguien la tenga, aunque después se publiquen otras.
+     *  \post Devuelve la versión de la última llamada a publish() (vacía, con version() == 0, si
+     * no se ha publicado ninguna)
+     */
+    std::shared_ptr<const Snapshot> snapshot() const {
+        return std::atomic_load(&published_);
+    }
+
+    /**
+     *  @brief Estadísticas de uso acumuladas
+     *  \post Devuelve los contadores de consultas de la estructura espacial junto con las altas,
+     * bajas y actualizaciones de Finder
+     */
+    FinderStats stats() const {
+        FinderStats s = backend_.stats();
+        s.adds = churn_.adds;
+        s.removes = churn_.removes;
+        s.updates = churn_.updates;
+        s.moves = churn_.moves;
+        return s;
+    }
+
+    /**
+     *  @brief Pone a cero las estadísticas
+     *  \post stats() devuelve todos los contadores a cero y se olvida el coste de cada cuadrado
+     */
+    void reset_stats() {
+        churn_ = FinderStats();
+        backend_.reset_stats();
+    }
+
+    /**
+     *  @brief Histograma de ocupación de la estructura espacial
+     *  @param hist Vector donde se deja el histograma
+     *  \post hist[k] es el número de cuadrados (o nodos) con k objetos; en AabbTree, el número de
+     * hojas a profundidad k
+     */
+    void occupancy(std::vector<size_t>& hist) const {
+        backend_.occupancy(hist);
+    }
+
+    /**
+     *  @brief Visita los cuadrados (o nodos) no vacíos que tocan 'rect', para dibujarlos
+     *  @param visit Función llamada como visit(const pro2::Rect& cell, size_t n_objects,
+     * uint64_t tested), donde tested es el número de candidatos que han comprobado en él las
+     * consultas
+     */
+    template <typename F>
+    void for_each_cell(const pro2::Rect& rect, F&& visit) const {
+        backend_.for_each_cell(rect, visit);
+    }
+
+    /**
+     *  @brief Escribe en 'out' los objetos con rectángulo total o parcial dentro de 'rect'.
+     *         El vector lo proporciona quien llama y se reutiliza entre fotogramas, de forma que
+     * cuando ya tiene capacidad suficiente la consulta no reserva memoria.
+     *  @param rect El rectángulo de búsqueda
+     *  @param out Vector donde se dejan los resultados (se vacía antes)
+     *  \post out contiene los objetos que intersectan con 'rect' ordenados por la esquina superior
+     * izquierda de su rectángulo (x y después y), un orden que no depende de las direcciones
+     */
+    void query(const pro2::Rect& rect, std::vector<T *>& out) {
+        scratch_.clear();
+        for_each(rect, [this](T *obj, const pro2::Rect& r) { scratch_.push_back({r, obj}); });
+        std::sort(scratch_.begin(), scratch_.end(), [](const auto& a, const auto& b) {
+            if (a.first.left != b.first.left) {
+                return a.first.left < b.first.left;
+            }
+            if (a.first.top != b.first.top) {
+                return a.first.top < b.first.top;
             }
-            if (!found) {
-                pos_map_[new_points[i]].insert(t);
+            if (a.first.right != b.first.right) {
+                return a.first.right < b.first.right;
             }
+            return a.first.bottom < b.first.bottom;
+        });
+        out.clear();
+        for (const auto& hit : scratch_) {
+            out.push_back(hit.second);
         }
     }
 
     /**
-     *  @brief Elimina un objeto de Finder
-     *         Quita el objeto de objects_ y de todos los cuadrados de pos_map_ donde estaba
-     * registrado. Si algún cuadrado se queda sin objetos después de eliminar t, también se elimina
-     * de pos_map_.
-     *  @param t Puntero al objeto a eliminar
-     *  \pre t debe tener método get_rect()
-     *  \post El objeto se ha eliminado de los dos maps
+     *  @brief Busca los k objetos más cercanos a un punto
+     *         Con HashGrid recorre los cuadrados por anillos alrededor de p y se para en cuanto
+     * ningún cuadrado por mirar puede tener un objeto más cercano; usa los mismos cuadrados que
+     * el resto de consultas, sin ningún índice aparte.
+     *  @param p Punto de referencia
+     *  @param k Número de objetos buscados
+     *  @param out Vector donde se dejan los resultados (se vacía antes)
+     *  \post out contiene los min(k, n) objetos más cercanos a p (la distancia es la del punto más
+     * cercano de su rectángulo), de más cerca a más lejos y, a igual distancia, por handle
      */
-    void remove(T *t) {
-        auto it = objects_.find(t);
-        if (it == objects_.end()) {
-            return;
+    void nearest(pro2::Pt p, size_t k, std::vector<T *>& out) {
+        backend_nearest(backend_, p, k, records_.size() - free_.size(), near_, 0);
+        std::sort(near_.begin(), near_.end());
+        out.clear();
+        for (const auto& hit : near_) {
+            out.push_back(records_[hit.second].obj);
         }
+    }
 
-        std::vector<pro2::Pt> mat_pts = vect_pts(it->second);
-        for (int i = 0; i < mat_pts.size(); ++i) {
-            pos_map_[mat_pts[i]].erase(t);
-            if (pos_map_[mat_pts[i]].empty()) {
-                pos_map_.erase(mat_pts[i]);
-            }
+    /**
+     *  @brief Busca los objetos a distancia como mucho r de un punto
+     *  @param p Punto de referencia
+     *  @param r Radio
+     *  @param out Vector donde se dejan los resultados (se vacía antes)
+     *  \post out contiene los objetos cuyo rectángulo está a distancia <= r de p, de más cerca a
+     * más lejos y, a igual distancia, por handle
+     */
+    void within(pro2::Pt p, int r, std::vector<T *>& out) {
+        const int64_t r2 = int64_t(r) * r;
+        near_.clear();
+        backend_.for_each({p.x - r, p.y - r, p.x + r, p.y + r},
+                          [this, p, r2](uint32_t h, const pro2::Rect& rect) {
+                              const int64_t d = dist2_pt_rect(p, rect);
+                              if (d <= r2) {
+                                  near_.push_back({d, h});
+                              }
+                          });
+        std::sort(near_.begin(), near_.end());
+        out.clear();
+        for (const auto& hit : near_) {
+            out.push_back(records_[hit.second].obj);
         }
-        objects_.erase(t);
     }
 
     /**
      *  @brief Devuelve el conjunto de objetos con rectángulo total o parcial dentro de 'rect'.
-     *         Primero encuentra todos los cuadrados de la cuadrícula que intersectan con el
-     * rectángulo, luego recoge todos los objetos en esos cuadrados, y finalmente filtra solo
-     * aquellos que realmente intersectan con el rectángulo. La eficiencia es O(log n) porque
-     * utiliza búsquedas en mapas ordenados.
      *  @param rect El rectángulo de búsqueda
      *  @returns Un conjunto de punteros a objetos que tienen un rectángulo parcial o total dentro
      * de 'rect'.
      */
     std::set<T *> query(pro2::Rect rect) {
-        std::set<T *>         query_pts;
-        std::vector<pro2::Pt> mat_pts = vect_pts(rect);
-
-        for (int i = 0; i < mat_pts.size(); ++i) {
-            auto it = pos_map_.find(mat_pts[i]);
-            if (it != pos_map_.end()) {
-                for (auto it2 = it->second.begin(); it2 != it->second.end(); ++it2) {
-                    pro2::Rect& obj_rect = objects_.find(*it2)->second;
-                    if (intesec_rect(rect, obj_rect)) {
-                        query_pts.insert(*it2);
-                    }
-                }
-            }
-        }
+        std::set<T *> query_pts;
+        for_each(rect, [&query_pts](T *obj, const pro2::Rect&) { query_pts.insert(obj); });
         return query_pts;
     }
 };
 
-#endif
\ No newline at end of file
+#endif
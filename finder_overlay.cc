@@ -0,0 +1,35 @@
+/** @file finder_overlay.cc
+ *  @brief Implementación de las funciones que dibujan el estado de un Finder
+ */
+
+#include "finder_overlay.hh"
+using namespace std;
+using namespace pro2;
+
+Color cost_color(uint64_t tested, uint64_t max_tested) {
+    // t en [0, 510]: de verde (0) a amarillo (255) y a rojo (510)
+    const uint64_t t = max_tested == 0 ? 0 : 510 * tested / max_tested;
+    const Color    r = t >= 255 ? 255 : Color(t);
+    const Color    g = t <= 255 ? 255 : Color(510 - t);
+    return (r << 16) | (g << 8);
+}
+
+void paint_finder_stats(pro2::Window& window, Pt pos, const FinderStats& stats) {
+    const uint64_t queries = stats.queries == 0 ? 1 : stats.queries;
+    const struct {
+        const char *name;
+        uint64_t    value;
+    } lines[] = {
+        {"QUERIES", stats.queries},
+        {"CELLS", stats.cells_touched / queries},
+        {"TESTED", stats.tested / queries},
+        {"ACCEPTED", stats.accepted / queries},
+        {"MOVES", stats.moves},
+        {"RELINKS", stats.relinks},
+    };
+    for (const auto& line : lines) {
+        paint_word(window, pos, line.name);
+        paint_num(window, {pos.x + 60, pos.y}, int(line.value));
+        pos.y += 10;
+    }
+}
@@ -0,0 +1,65 @@
+/** @file finder_overlay.hh
+ *  @brief Especificación de las funciones que dibujan el estado de un Finder (modo depuración)
+ */
+
+#ifndef FINDER_OVERLAY_HH
+#define FINDER_OVERLAY_HH
+
+#include "finder_stats.hh"
+#include "paintsprites.hh"
+#include "utils.hh"
+#include "window.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#endif
+
+/**
+ * @brief Color de un cuadrado según su coste
+ * @param tested Candidatos comprobados en el cuadrado
+ * @param max_tested Máximo de candidatos comprobados entre los cuadrados dibujados
+ * \pre tested <= max_tested
+ * \post Devuelve un color de verde (sin coste) a amarillo y a rojo (el cuadrado más caro)
+ */
+pro2::Color cost_color(uint64_t tested, uint64_t max_tested);
+
+/**
+ * @brief Dibuja un resumen de las estadísticas de un Finder
+ * @param window Ventana en la que se dibuja
+ * @param pos Esquina superior izquierda del resumen
+ * @param stats Estadísticas (Finder::stats())
+ * \post Se han dibujado las consultas y, por consulta, los cuadrados recorridos, los candidatos
+ * comprobados y los aceptados; también los movimientos y los cambios de cuadrado
+ */
+void paint_finder_stats(pro2::Window& window, pro2::Pt pos, const FinderStats& stats);
+
+/**
+ * @brief Dibuja los cuadrados (o nodos) no vacíos de un Finder que tocan 'area'
+ *        El borde de cada cuadrado se pinta con cost_color según los candidatos que han
+ *        comprobado en él las consultas, relativo al cuadrado más caro de los dibujados, y en su
+ *        esquina se escribe cuántos objetos contiene. Sirve para ver cuadrados calientes o un
+ *        tamaño de cuadrado mal ajustado.
+ * @param window Ventana en la que se dibuja
+ * @param finder Finder (o cualquier índice con for_each_cell)
+ * @param area Zona del mundo a dibujar (normalmente la cámara)
+ */
+template <typename Index>
+void paint_finder_overlay(pro2::Window& window, const Index& finder, const pro2::Rect& area) {
+    uint64_t max_tested = 0;
+    finder.for_each_cell(area, [&max_tested](const pro2::Rect&, size_t, uint64_t tested) {
+        max_tested = std::max(max_tested, tested);
+    });
+    finder.for_each_cell(area, [&](const pro2::Rect& cell, size_t n_objects, uint64_t tested) {
+        const pro2::Rect r = {std::max(cell.left, area.left), std::max(cell.top, area.top),
+                              std::min(cell.right, area.right), std::min(cell.bottom, area.bottom)};
+        const pro2::Color color = cost_color(tested, max_tested);
+        paint_hline(window, r.left, r.right, r.top, color);
+        paint_hline(window, r.left, r.right, r.bottom, color);
+        paint_vline(window, r.left, r.top, r.bottom, color);
+        paint_vline(window, r.right, r.top, r.bottom, color);
+        paint_num(window, {r.left + 3, r.top + 5}, int(n_objects));
+    });
+}
+
+#endif
@@ -0,0 +1,198 @@
+/** @file finder_snapshot.hh
+ *  @brief Especificación de la clase FinderSnapshot
+ */
+
+#ifndef FINDER_SNAPSHOT_HH
+#define FINDER_SNAPSHOT_HH
+
+#include "flat_map.hh"
+#include "sweep.hh"
+#include "utils.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#endif
+
+/** @class FinderSnapshot
+ *  @brief Versión inmutable del contenido de un Finder, para consultarla desde otros hilos.
+ *
+ *  El plano se divide en páginas cuadradas de P píxeles; cada página es un vector inmutable con
+ *  los objetos que la tocan (puntero y rectángulo en el momento de publicarla), compartido con
+ *  shared_ptr entre versiones. Finder::publish() crea una versión nueva copiando la tabla de
+ *  páginas de la anterior y rehaciendo solo las páginas con cambios, de forma que las páginas
+ *  sin cambios no se copian.
+ *
+ *  Una versión publicada no se modifica nunca y sus consultas no tocan ningún estado (ni
+ *  contadores), así que cualquier número de hilos puede consultarla a la vez sin bloqueos mientras
+ *  el hilo principal sigue actualizando Finder. Los rectángulos son los de la publicación; leer
+ *  el objeto a través del puntero sí necesita la sincronización que tenga el propio objeto.
+ *
+ *  @tparam T Tipo de objeto
+ *  @tparam P Lado en píxeles de las páginas
+ */
+template <typename T, int P = 512>
+class FinderSnapshot {
+ public:
+    /**
+     * @class Entry
+     * @brief Objeto de una página con su rectángulo publicado
+     */
+    struct Entry {
+        T         *obj;
+        pro2::Rect rect;
+    };
+
+    /// @brief Contenido de una página.
+    typedef std::vector<Entry> Page;
+
+    /// @brief Resultado de sweep() y segment().
+    typedef SweepHit<T> Hit;
+
+ private:
+    static_assert(P > 0, "El tamaño de las páginas debe ser positivo");
+
+    /// @brief Páginas no vacías indexadas por su clave.
+    FlatMap<uint64_t, std::shared_ptr<const Page>> pages_;
+
+    /// @brief Número de publicación (1 la primera).
+    uint64_t version_ = 0;
+
+    /**
+     * @brief División entera redondeando hacia -infinito
+     */
+    static int floor_div(int v) {
+        return (v < 0 ? v - P + 1 : v) / P;
+    }
+
+ public:
+    /// @brief Constructora de una versión vacía (versión 0).
+    FinderSnapshot() {}
+
+    /**
+     * @brief Empaqueta la posición de una página como clave de la tabla
+     */
+    static uint64_t page_key(int px, int py) {
+        return (uint64_t(uint32_t(px)) << 32) | uint64_t(uint32_t(py));
+    }
+
+    /**
+     * @brief Rango de páginas que toca un rectángulo
+     * \post Devuelve el rectángulo (en coordenadas de página) de las páginas que toca rect
+     */
+    static pro2::Rect page_range(const pro2::Rect& rect) {
+        return {floor_div(rect.left), floor_div(rect.top), floor_div(rect.right),
+                floor_div(rect.bottom)};
+    }
+
+    /**
+     * @brief Rectángulo del mundo que cubre una página
+     * @param key Clave de la página (page_key)
+     */
+    static pro2::Rect page_rect(uint64_t key) {
+        const int px = int(uint32_t(key >> 32));
+        const int py = int(uint32_t(key));
+        return {px * P, py * P, px * P + P - 1, py * P + P - 1};
+    }
+
+    /**
+     * @brief Prepara la versión siguiente
+     * \post Devuelve una versión con el número siguiente que comparte todas las páginas de esta
+     */
+    FinderSnapshot next() const {
+        FinderSnapshot s(*this);
+        s.version_++;
+        return s;
+    }
+
+    /**
+     * @brief Sustituye una página (solo mientras se prepara la versión, antes de publicarla)
+     * @param key Clave de la página
+     * @param page Nuevo contenido (si está vacío, la página se quita)
+     */
+    void set_page(uint64_t key, Page&& page) {
+        if (page.empty()) {
+            pages_.erase(key);
+        } else {
+            pages_[key] = std::make_shared<const Page>(std::move(page));
+        }
+    }
+
+    /**
+     * @brief Número de publicación
+     * \post Devuelve 0 si es la versión vacía y n si es la n-ésima llamada a Finder::publish()
+     */
+    uint64_t version() const {
+        return version_;
+    }
+
+    /**
+     * @brief Visita los objetos que intersectan con rect
+     *        Un objeto que ocupa varias páginas solo se acepta en la página que contiene la
+     *        esquina superior izquierda de su intersección con 'rect' (como en HashGrid).
+     * @param visit Función llamada como visit(T *obj, const pro2::Rect& obj_rect)
+     * \post Se ha llamado a visit una vez por objeto
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, F&& visit) const {
+        const pro2::Rect pages = page_range(rect);
+        for (int px = pages.left; px <= pages.right; ++px) {
+            for (int py = pages.top; py <= pages.bottom; ++py) {
+                const std::shared_ptr<const Page> *page = pages_.find(page_key(px, py));
+                if (page == nullptr) {
+                    continue;
+                }
+                for (const Entry& e : **page) {
+                    if (intesec_rect(rect, e.rect) &&
+                        floor_div(std::max(rect.left, e.rect.left)) == px &&
+                        floor_div(std::max(rect.top, e.rect.top)) == py) {
+                        visit(e.obj, e.rect);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Escribe en 'out' los objetos que intersectan con 'rect'
+     * @param out Vector donde se dejan los resultados (se vacía antes)
+     * \post out contiene los objetos que intersectan con 'rect' con su rectángulo publicado,
+     * ordenados por la esquina superior izquierda del rectángulo, como en Finder::query
+     */
+    void query(const pro2::Rect& rect, std::vector<Entry>& out) const {
+        out.clear();
+        for_each(rect, [&out](T *obj, const pro2::Rect& r) { out.push_back({obj, r}); });
+        std::sort(out.begin(), out.end(), [](const Entry& a, const Entry& b) {
+            if (a.rect.left != b.rect.left) {
+                return a.rect.left < b.rect.left;
+            }
+            if (a.rect.top != b.rect.top) {
+                return a.rect.top < b.rect.top;
+            }
+            if (a.rect.right != b.rect.right) {
+                return a.rect.right < b.rect.right;
+            }
+            return a.rect.bottom < b.rect.bottom;
+        });
+    }
+
+    /**
+     * @brief Barrido de un rectángulo en movimiento, como en Finder::sweep
+     * \post out contiene los objetos que toca box al desplazarse delta, ordenados por el instante
+     * del primer contacto
+     */
+    void sweep(const pro2::Rect& box, pro2::Pt delta, std::vector<Hit>& out) const {
+        sweep_index(*this, box, delta, out);
+    }
+
+    /**
+     * @brief Objetos que toca el segmento de 'from' a 'to', como en Finder::segment
+     */
+    void segment(pro2::Pt from, pro2::Pt to, std::vector<Hit>& out) const {
+        sweep({from.x, from.y, from.x, from.y}, {to.x - from.x, to.y - from.y}, out);
+    }
+};
+
+#endif
@@ -0,0 +1,32 @@
+/** @file finder_stats.hh
+ *  @brief Especificación de la estructura FinderStats
+ */
+
+#ifndef FINDER_STATS_HH
+#define FINDER_STATS_HH
+
+#ifndef NO_DIAGRAM
+#include <cstdint>
+#endif
+
+/**
+ * @class FinderStats
+ * @brief Contadores de uso de Finder y de su estructura espacial
+ *
+ * La estructura espacial cuenta el coste de las consultas y de los movimientos; Finder añade los
+ * contadores de altas, bajas y actualizaciones. Se acumulan desde la creación de Finder o desde
+ * el último reset_stats().
+ */
+struct FinderStats {
+    uint64_t queries = 0;        ///< Consultas (llamadas a for_each)
+    uint64_t cells_touched = 0;  ///< Cuadrados o nodos recorridos por las consultas
+    uint64_t tested = 0;         ///< Candidatos comprobados con intesec_rect
+    uint64_t accepted = 0;       ///< Candidatos que intersectan con la consulta (visitados)
+    uint64_t relinks = 0;        ///< Movimientos que han cambiado de cuadrado o de nodo
+    uint64_t adds = 0;           ///< Objetos añadidos
+    uint64_t removes = 0;        ///< Objetos eliminados
+    uint64_t updates = 0;        ///< Objetos actualizados (update o update_many)
+    uint64_t moves = 0;          ///< Actualizaciones en las que el rectángulo había cambiado
+};
+
+#endif
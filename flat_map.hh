@@ -0,0 +1,245 @@
+/** @file flat_map.hh
+ *  @brief Especificación e implementación de la clase FlatMap
+ */
+
+#ifndef FLAT_MAP_HH
+#define FLAT_MAP_HH
+
+#ifndef NO_DIAGRAM
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#endif
+
+/**
+ * @brief Mezcla una clave entera para repartirla por la tabla (hashing de Fibonacci).
+ * @param key Clave a mezclar
+ * \post Devuelve un valor de 64 bits con los bits altos bien distribuidos
+ */
+inline uint64_t flat_hash(uint64_t key) {
+    return key * 0x9E3779B97F4A7C15ull;
+}
+
+/**
+ * @brief Mezcla un puntero para usarlo como clave de la tabla.
+ * @param key Puntero a mezclar
+ * \post Devuelve un valor de 64 bits con los bits altos bien distribuidos
+ */
+template <typename P>
+inline uint64_t flat_hash(P *key) {
+    return flat_hash(uint64_t(reinterpret_cast<uintptr_t>(key)));
+}
+
+/**
+ * @class FlatMap
+ * @brief Tabla de hash de direccionamiento abierto (sondeo lineal) guardada en un único vector.
+ *
+ * A diferencia de `std::map` no reserva un nodo por elemento: todas las entradas viven en un
+ * vector contiguo, de forma que las búsquedas recorren memoria lineal. Al borrar se desplazan
+ * hacia atrás las entradas siguientes del mismo grupo (backward shift), así que no quedan
+ * lápidas y la tabla no se degrada con las inserciones y borrados continuos.
+ *
+ * @tparam K Tipo de la clave (entero de 64 bits o puntero)
+ * @tparam V Tipo del valor asociado
+ */
+template <typename K, typename V>
+class FlatMap {
+ private:
+    /**
+     * @class Slot
+     * @brief Casilla de la tabla
+     */
+    struct Slot {
+        K    key;
+        V    value;
+        bool used = false;
+    };
+
+    std::vector<Slot> slots_;
+    size_t            size_ = 0;
+    int               bits_ = 0;
+
+    /**
+     * @brief Casilla ideal de una clave
+     * \pre La tabla tiene capacidad > 0
+     * \post Devuelve la posición donde empieza el sondeo de key
+     */
+    size_t home(const K& key) const {
+        return size_t(flat_hash(key) >> (64 - bits_));
+    }
+
+    /**
+     * @brief Redimensiona la tabla a 2^bits casillas y reinserta todas las entradas
+     * \post La tabla tiene 2^bits casillas y conserva todos sus elementos
+     */
+    void rehash(int bits) {
+        std::vector<Slot> old;
+        old.swap(slots_);
+        slots_.resize(size_t(1) << bits);
+        bits_ = bits;
+        const size_t mask = slots_.size() - 1;
+        for (Slot& s : old) {
+            if (s.used) {
+                size_t i = home(s.key);
+                while (slots_[i].used) {
+                    i = (i + 1) & mask;
+                }
+                slots_[i].key = s.key;
+                slots_[i].value = std::move(s.value);
+                slots_[i].used = true;
+            }
+        }
+    }
+
+ public:
+    /// @brief Constructora de una tabla vacía.
+    FlatMap() {}
+
+    /**
+     * @brief Número de elementos
+     * \post Devuelve el número de claves guardadas
+     */
+    size_t size() const {
+        return size_;
+    }
+
+    /**
+     * @brief Reserva espacio para n elementos sin tener que volver a redimensionar
+     * \post La tabla puede contener n elementos con factor de carga <= 1/2
+     */
+    void reserve(size_t n) {
+        int bits = bits_ < 4 ? 4 : bits_;
+        while ((size_t(1) << bits) < 2 * n) {
+            bits++;
+        }
+        if (bits != bits_) {
+            rehash(bits);
+        }
+    }
+
+    /**
+     * @brief Busca una clave
+     * \post Devuelve un puntero al valor asociado a key, o nullptr si no está
+     */
+    V *find(const K& key) {
+        if (size_ == 0) {
+            return nullptr;
+        }
+        const size_t mask = slots_.size() - 1;
+        for (size_t i = home(key); slots_[i].used; i = (i + 1) & mask) {
+            if (slots_[i].key == key) {
+                return &slots_[i].value;
+            }
+        }
+        return nullptr;
+    }
+
+    /**
+     * @brief Busca una clave (versión constante)
+     * \post Devuelve un puntero al valor asociado a key, o nullptr si no está
+     */
+    const V *find(const K& key) const {
+        return const_cast<FlatMap *>(this)->find(key);
+    }
+
+    /**
+     * @brief Acceso con inserción
+     * \post Devuelve una referencia al valor de key; si no existía se crea con V()
+     */
+    V& operator[](const K& key) {
+        if (2 * (size_ + 1) > slots_.size()) {
+            rehash(bits_ < 4 ? 4 : bits_ + 1);
+        }
+        const size_t mask = slots_.size() - 1;
+        size_t       i = home(key);
+        while (slots_[i].used) {
+            if (slots_[i].key == key) {
+                return slots_[i].value;
+            }
+            i = (i + 1) & mask;
+        }
+        slots_[i].key = key;
+        slots_[i].value = V();
+        slots_[i].used = true;
+        size_++;
+        return slots_[i].value;
+    }
+
+    /**
+     * @brief Elimina una clave
+     * \post Si key estaba, se elimina y se compacta su grupo de sondeo; devuelve si estaba
+     */
+    bool erase(const K& key) {
+        if (size_ == 0) {
+            return false;
+        }
+        const size_t mask = slots_.size() - 1;
+        size_t       i = home(key);
+        while (slots_[i].used && !(slots_[i].key == key)) {
+            i = (i + 1) & mask;
+        }
+        if (!slots_[i].used) {
+            return false;
+        }
+        // Backward shift: se adelantan las entradas que quedarían inalcanzables
+        size_t j = i;
+        while (true) {
+            j = (j + 1) & mask;
+            if (!slots_[j].used) {
+                break;
+            }
+            size_t h = home(slots_[j].key);
+            bool   movable = (i <= j) ? (h <= i || h > j) : (h <= i && h > j);
+            if (movable) {
+                slots_[i].key = slots_[j].key;
+                slots_[i].value = std::move(slots_[j].value);
+                i = j;
+            }
+        }
+        slots_[i].used = false;
+        slots_[i].value = V();
+        size_--;
+        return true;
+    }
+
+    /**
+     * @brief Vacía la tabla
+     * \post size() == 0 (se conserva la capacidad)
+     */
+    void clear() {
+        for (Slot& s : slots_) {
+            s.used = false;
+            s.value = V();
+        }
+        size_ = 0;
+    }
+
+    /**
+     * @brief Recorre todas las entradas en orden de la tabla
+     * @param f Función llamada como f(clave, valor) para cada entrada
+     */
+    template <typename F>
+    void for_each(F&& f) {
+        for (Slot& s : slots_) {
+            if (s.used) {
+                f(s.key, s.value);
+            }
+        }
+    }
+
+    /**
+     * @brief Recorre todas las entradas en orden de la tabla (versión constante)
+     * @param f Función llamada como f(clave, valor) para cada entrada
+     */
+    template <typename F>
+    void for_each(F&& f) const {
+        for (const Slot& s : slots_) {
+            if (s.used) {
+                f(s.key, s.value);
+            }
+        }
+    }
+};
+
+#endif
@@ -11,22 +11,30 @@ Game::Game(int width, int height)
       paused_(false),
       game_over_(false),
       winner_(false),
+      debug_overlay_(false),
       start_screen_(true),
       double_points_active_(false),
       powerup_frames_remaining_(0),
       enemy_({height / 2}, width),
       vides_(N_LIVES) {
+    platforms_.reserve(N_PLATFORMS + 3);
     platforms_.push_back(Platform(100, 300, 200, 211));
     platforms_.push_back(Platform(0, 200, 250, 261));
     platforms_.push_back(Platform(250, 400, 150, 161));
 
-    aliens_.push_back(Alien({160, 186}, NONE));
-    aliens_.push_back(Alien({100, 236}, X_MOV));
+    aliens_.emplace(Pt{160, 186}, NONE);
+    aliens_.emplace(Pt{100, 236}, X_MOV);
 
     srand(time(0));
 
+    // Los objetos se recogen aquí y se indexan de golpe al final con bulk_build. Cada objeto
+    // guarda su handle en el SlotMap que lo contiene (set_slot) para poder borrarlo después.
+    std::vector<Alien *>   alien_ptrs;
+    std::vector<PowerUp *> powerup_ptrs;
+    std::vector<Medkit *>  medkit_ptrs;
     for (auto it = aliens_.begin(); it != aliens_.end(); ++it) {
-        alien_finder_.add(&(*it));
+        it->set_slot(it.handle());
+        alien_ptrs.push_back(&*it);
     }
 
     int last_right = 400;
@@ -42,8 +50,14 @@ Game::Game(int width, int height)
         last_right = right;
     }
 
+    std::vector<Platform *> platform_ptrs;
+    platform_ptrs.reserve(platforms_.size());
+    for (Platform& p : platforms_) {
+        platform_ptrs.push_back(&p);
+    }
+    platform_finder_.build(platform_ptrs);
+
     for (int i = 0; i < platforms_.size(); i++) {
-        platform_finder_.add(&platforms_[i]);
         if (i > 1) {
             const Platform& platform = platforms_[i];
             int             platwidth = platform.get_rect().right - platform.get_rect().left;
@@ -53,21 +67,28 @@ Game::Game(int width, int height)
             if (rand() % 7 == 0) {
                 int x_pos2 = platform.get_rect().left + (rand() % platwidth);
                 int y_pos = platform.get_rect().top - 20;
-                powerups_.push_back(PowerUp({x_pos2, y_pos}));
-                powerup_finder_.add(&powerups_.back());
+                const SlotHandle h = powerups_.emplace(Pt{x_pos2, y_pos});
+                powerup_ptrs.push_back(powerups_.get(h));
+                powerup_ptrs.back()->set_slot(h);
             }
 
             if (rand() % 7 == 0) {
                 int x_pos_med = platform.get_rect().left + (rand() % platwidth);
-                medkits_.push_back(Medkit({x_pos_med, platform.get_rect().top - 20}));
-                medkit_finder_.add(&medkits_.back());
+                const SlotHandle h = medkits_.emplace(Pt{x_pos_med, platform.get_rect().top - 20});
+                medkit_ptrs.push_back(medkits_.get(h));
+                medkit_ptrs.back()->set_slot(h);
             }
 
             movement_type mov = movement_type(rand() % 3);
-            aliens_.push_back(Alien({x_pos, y_pos}, mov));
-            alien_finder_.add(&aliens_.back());
+            const SlotHandle h = aliens_.emplace(Pt{x_pos, y_pos}, mov);
+            alien_ptrs.push_back(aliens_.get(h));
+            alien_ptrs.back()->set_slot(h);
         }
     }
+
+    entity_finder_.bulk_build(alien_ptrs);
+    entity_finder_.bulk_build(powerup_ptrs);
+    entity_finder_.bulk_build(medkit_ptrs);
 }
 
 void Game::process_keys(pro2::Window& window) {
@@ -91,6 +112,10 @@ void Game::process_keys(pro2::Window& window) {
         paused_ = !paused_;
         return;
     }
+
+    if (window.was_key_pressed('G')) {
+        debug_overlay_ = !debug_overlay_;
+    }
 }
 
 void Game::update_camera(pro2::Window& window) {
@@ -126,55 +151,78 @@ void Game::update(pro2::Window& window) {
 }
 
 void Game::update_objects(pro2::Window& window) {
+    Alien::set_frame(window.frame_count());
     Rect area_visible = window.camera_rect();
-    platforms_visibles_ = platform_finder_.query(area_visible);
-    aliens_visibles_ = alien_finder_.query(area_visible);
-    powerups_visibles_ = powerup_finder_.query(area_visible);
-    medkits_visibles_ = medkit_finder_.query(area_visible);
+    platforms_visibles_.refresh(platform_finder_, area_visible);
+    // Un solo recorrido de la cuadrícula para los tres tipos
+    entity_finder_.refresh_visible(area_visible, aliens_visibles_, powerups_visibles_,
+                                   medkits_visibles_);
 
     update_platforms(window);
     update_powerups(window);
     update_medkits(window);
     update_aliens(window);
-    player_.update(window, platforms_visibles_);
+    player_.update(window, platform_finder_);
     update_enemy(window);
     check_fall(window);
+    reclaim_dead(window);
+}
+
+void Game::reclaim_dead(pro2::Window& window) {
+    for (SlotMap<Alien>::Handle h : dying_aliens_) {
+        if (aliens_.erase(h)) {
+            aliens_reclaimed_++;
+        }
+    }
+    dying_aliens_.clear();
+    if (window.frame_count() % COMPACT_FRAMES == 0) {
+        bytes_reclaimed_ += aliens_.compact() + powerups_.compact() + medkits_.compact();
+    }
 }
 
 void Game::update_platforms(pro2::Window& window) {
     for (Platform *p : platforms_visibles_) {
         p->update();
-        platform_finder_.update(p);
         if (player_.is_grounded() &&
             p->has_crossed_floor_downwards(player_.last_pos(), player_.pos())) {
             p->start_moving();
         }
+        if (p->is_moving()) {
+            platforms_visibles_.touch(p);
+        }
     }
+    platform_finder_.update_many(platforms_visibles_.items());
 }
 
 void Game::update_powerups(pro2::Window& window) {
     for (PowerUp *pu : powerups_visibles_) {
         pu->update();
-        powerup_finder_.update(pu);
     }
+    entity_finder_.update_many(powerups_visibles_.items());
+    powerups_visibles_.touch_all(entity_finder_.moved<PowerUp>());
     powerup_collision_();
     powerup_timer();
 }
 
 void Game::update_medkits(pro2::Window& window) {
-    for (Medkit *mk : medkits_visibles_) {
-        medkit_finder_.update(mk);
-    }
+    entity_finder_.update_many(medkits_visibles_.items());
+    medkits_visibles_.touch_all(entity_finder_.moved<Medkit>());
     if (vides_.getCurrent() != vides_.getMax()) {
         medkit_collision_();
     }
 }
 
 void Game::update_aliens(pro2::Window& window) {
-    for (Alien *a : aliens_visibles_) {
-        a->update(window);
-        alien_finder_.update(a);
-        colision(a);
+    // La posición de los aliens se calcula al pedirla (Alien::set_frame) y no sale nunca de su
+    // zona en entity_finder_ ni en aliens_visibles_ (MotionRect), así que no hay que actualizarlos.
+    // Barrido del jugador desde su posición anterior: solo se miran los aliens del recorrido
+    const Pt   delta = {player_.pos().x - player_.last_pos().x,
+                        player_.pos().y - player_.last_pos().y};
+    const Rect p = player_.get_rect();
+    const Rect from = {p.left - delta.x, p.top - delta.y, p.right - delta.x, p.bottom - delta.y};
+    entity_finder_.layer<Alien>().sweep(from, delta, alien_hits_);
+    for (const auto& hit : alien_hits_) {
+        colision(hit.obj);
     }
 }
 
@@ -201,18 +249,21 @@ void Game::check_fall(pro2::Window& window) {
 }
 
 void Game::colision(Alien *a) {
-    Rect p = player_.get_rect();
-    Rect d = a->get_rect();
-    if (intesec_rect(p, d)) {
-        if (double_points_active_) {
-            player_.add_point(2);
-        } else {
-            player_.add_point(1);
-        }
-        alien_finder_.remove(a);
-        if (player_.n_points() >= WINNER_POINTS) {
-            winner_ = true;
-        }
+    EntityFinder::Handle h;
+    if (a->state() != ALIVE || !entity_finder_.handle(a, h)) {
+        return;
+    }
+    if (double_points_active_) {
+        player_.add_point(2);
+    } else {
+        player_.add_point(1);
+    }
+    a->kill();
+    dying_aliens_.push_back(a->slot());
+    entity_finder_.remove<Alien>(h);
+    aliens_visibles_.erase(a);
+    if (player_.n_points() >= WINNER_POINTS) {
+        winner_ = true;
     }
 }
 
@@ -254,6 +305,15 @@ void Game::paint(pro2::Window& window) {
         player_.paint(window);
         enemy_.paint(window);
 
+        if (debug_overlay_) {
+            paint_finder_overlay(window, entity_finder_, window.camera_rect());
+            paint_finder_stats(window,
+                               {window.topleft().x + 10, window.topleft().y + window.height() - 70},
+                               entity_finder_.stats());
+            paint_memory_stats(window, {window.topleft().x + 150,
+                                        window.topleft().y + window.height() - 70});
+        }
+
         paint_scores(window);
         vides_.paint(window);
         if (double_points_active_) {
@@ -265,6 +325,25 @@ void Game::paint(pro2::Window& window) {
     paint_square(window, rect, black, 4);
 }
 
+void Game::paint_memory_stats(pro2::Window& window, Pt pos) {
+    const size_t bytes =
+        aliens_.memory_bytes() + powerups_.memory_bytes() + medkits_.memory_bytes();
+    const struct {
+        const char *name;
+        size_t      value;
+    } lines[] = {
+        {"ALIENS", aliens_.size()},
+        {"KILLED", aliens_reclaimed_},
+        {"KB", bytes / 1024},
+        {"FREED KB", bytes_reclaimed_ / 1024},
+    };
+    for (const auto& line : lines) {
+        paint_word(window, pos, line.name);
+        paint_num(window, {pos.x + 60, pos.y}, int(line.value));
+        pos.y += 10;
+    }
+}
+
 void Game::paint_double_score(pro2::Window& window) {
     Pt powerup_pos = {window.topleft().x + window.width() - 50, window.topleft().y + 30};
     paint_word(window, powerup_pos, "X");
@@ -329,10 +408,15 @@ void Game::paint_winner_screen(pro2::Window& window) {
 void Game::check_bullet_colission() {
     bool        bullet_hit = false;
     const auto& bullets = enemy_.get_bullets();
+    const Rect  p = player_.get_rect();
+    // Zona del jugador en la que una bala (un punto) hace daño
+    const Rect  body = {p.left + 1, p.top + 2, p.right - 1, p.bottom - 2};
     for (const auto& bullet : bullets) {
-        Rect p = player_.get_rect();
-        Rect b = {bullet.x + 1, bullet.y + 2, bullet.x - 1, bullet.y - 2};
-        if (intesec_rect(b, p)) {
+        const int from_x = bullet.x + Enemy::BULLET_SPEED;
+        float     t;
+        Pt        normal;
+        if (sweep_rect({from_x, bullet.y, from_x, bullet.y}, {-Enemy::BULLET_SPEED, 0}, body, t,
+                       normal)) {
             bullet_hit = true;
         }
     }
@@ -355,40 +439,36 @@ void Game::powerup_timer() {
 }
 
 void Game::powerup_collision_() {
-    for (List<PowerUp>::iterator it = powerups_.begin(); it != powerups_.end();) {
-        if (!(*it).is_collected()) {
-            Rect p = player_.get_rect();
-            Rect pu = (*it).get_rect();
-            if (intesec_rect(p, pu)) {
-                (*it).collect();
-                double_points_active_ = true;
-                powerup_frames_remaining_ = PowerUp::DURATION_FRAMES;
-                powerup_finder_.remove(&(*it));
-                it = powerups_.erase(it);
-            } else {
-                ++it;
-            }
-        } else {
-            ++it;
+    powerup_hits_.clear();
+    entity_finder_.layer<PowerUp>().for_each(
+        player_.get_rect(), [this](PowerUp *pu, const Rect&) { powerup_hits_.push_back(pu); });
+    for (PowerUp *pu : powerup_hits_) {
+        EntityFinder::Handle h;
+        if (pu->is_collected() || !entity_finder_.handle(pu, h)) {
+            continue;
         }
+        pu->collect();
+        double_points_active_ = true;
+        powerup_frames_remaining_ = PowerUp::DURATION_FRAMES;
+        entity_finder_.remove<PowerUp>(h);
+        powerups_visibles_.erase(pu);
+        powerups_.erase(pu->slot());
     }
 }
 
 void Game::medkit_collision_() {
-    for (List<Medkit>::iterator it = medkits_.begin(); it != medkits_.end();) {
-        if ((*it).is_active()) {
-            Rect p = player_.get_rect();
-            Rect med = (*it).get_rect();
-            if (intesec_rect(p, med)) {
-                (*it).collect();
-                vides_.restore();
-                medkit_finder_.remove(&(*it));
-                it = medkits_.erase(it);
-            } else {
-                ++it;
-            }
-        } else {
-            ++it;
+    medkit_hits_.clear();
+    entity_finder_.layer<Medkit>().for_each(
+        player_.get_rect(), [this](Medkit *mk, const Rect&) { medkit_hits_.push_back(mk); });
+    for (Medkit *mk : medkit_hits_) {
+        EntityFinder::Handle h;
+        if (!mk->is_active() || !entity_finder_.handle(mk, h)) {
+            continue;
         }
+        mk->collect();
+        vides_.restore();
+        entity_finder_.remove<Medkit>(h);
+        medkits_visibles_.erase(mk);
+        medkits_.erase(mk->slot());
     }
 }
@@ -8,19 +8,22 @@
 #include "alien.hh"
 #include "enemy.hh"
 #include "finder.hh"
-#include "list.hh"
+#include "finder_overlay.hh"
+#include "layered_finder.hh"
 #include "mario.hh"
 #include "medkit.hh"
 #include "paintsprites.hh"
 #include "platform.hh"
 #include "powerup.hh"
+#include "slot_map.hh"
+#include "strip_finder.hh"
 #include "utils.hh"
 #include "vides_list.hh"
+#include "visible_set.hh"
 #include "window.hh"
 
 #ifndef NO_DIAGRAM
 #include <cstdlib>
-#include <set>
 #include <vector>
 #endif
 
@@ -50,32 +53,59 @@
 class Game {
     Mario                 player_;
     std::vector<Platform> platforms_;
-    List<Alien>           aliens_;
+    SlotMap<Alien>        aliens_;
+
+    /// @brief Aliens eliminados en este fotograma (en estado DYING), que se destruyen al final.
+    std::vector<SlotMap<Alien>::Handle> dying_aliens_;
+
+    size_t aliens_reclaimed_ = 0;  ///< Aliens destruidos desde el principio de la partida
+    size_t bytes_reclaimed_ = 0;   ///< Memoria devuelta por las compactaciones
 
     bool finished_;
     bool paused_;
     bool game_over_;
     bool start_screen_;
     bool winner_;
+    bool debug_overlay_;  ///< Si se dibuja la cuadrícula y las estadísticas de entity_finder_
 
     const int N_PLATFORMS = 35000;
     const int N_LIVES = 3;
     const int WINNER_POINTS = 25;
 
-    Finder<Alien>        alien_finder_;
-    Finder<Platform>     platform_finder_;
-    std::set<Alien *>    aliens_visibles_;
-    std::set<Platform *> platforms_visibles_;
+    /// @brief Cada cuántos fotogramas se liberan los bloques vacíos de los contenedores.
+    static const int COMPACT_FRAMES = 600;
+
+    // Tamaño de los cuadrados de entity_finder_, elegido con bench/cell_tuning para los aliens,
+    // que son la capa más consultada (las plataformas usan StripFinder, que no tiene cuadrícula)
+    static const int ENTITY_CELL = 256;
+
+    /// @brief Índice único de aliens, power-ups y botiquines, con una capa por tipo.
+    typedef LayeredFinder<ENTITY_CELL, Alien, PowerUp, Medkit> EntityFinder;
+
+    EntityFinder          entity_finder_;
+    StripFinder<Platform> platform_finder_;
+
+    /// @brief Aliens cuya zona de movimiento toca la cámara (su posición se calcula al pedirla).
+    VisibleSet<Alien, MotionRect> aliens_visibles_;
 
-    List<PowerUp>       powerups_;
+    VisibleSet<Platform> platforms_visibles_;
+
+    /// @brief Aliens que toca el jugador en su último desplazamiento (se reutiliza).
+    std::vector<EntityFinder::View<Alien>::Hit> alien_hits_;
+
+    SlotMap<PowerUp>    powerups_;
     bool                double_points_active_;
     int                 powerup_frames_remaining_;
-    Finder<PowerUp>     powerup_finder_;
-    std::set<PowerUp *> powerups_visibles_;
+    VisibleSet<PowerUp> powerups_visibles_;
+
+    /// @brief Power-ups que toca el jugador (se reutiliza).
+    std::vector<PowerUp *> powerup_hits_;
 
-    List<Medkit>       medkits_;
-    Finder<Medkit>     medkit_finder_;
-    std::set<Medkit *> medkits_visibles_;
+    SlotMap<Medkit>    medkits_;
+    VisibleSet<Medkit> medkits_visibles_;
+
+    /// @brief Botiquines que toca el jugador (se reutiliza).
+    std::vector<Medkit *> medkit_hits_;
 
     Enemy     enemy_;
     VidesList vides_;
@@ -128,8 +158,7 @@ class Game {
      * @brief Actualiza los aliens del juego
      * @param window Referencia a la ventana del juego
      * \pre Lista de aliens debe estar inicializada
-     * \post Actualiza la posición y el estado de aliens visibles
-     * \post Detecta colisiones con el jugador
+     * \post Detecta colisiones con el jugador a lo largo de todo su último desplazamiento
      */
     void update_aliens(pro2::Window& window);
 
@@ -160,18 +189,39 @@ class Game {
     void update_camera(pro2::Window& window);
 
     /**
-     * @brief Detecta las colisiones entre el jugador y un alien
+     * @brief Aplica la colisión entre el jugador y un alien
      * @param a Puntero al alien con el que se colisiona
-     * \pre Alien debe existir y estar activo
-     * \post Alien es eliminado del juego
+     * \pre Alien debe existir y estar activo, y el jugador lo ha tocado (ver update_aliens)
+     * \post El alien pasa a DYING, se quita de entity_finder_ y de aliens_visibles_ y queda en
+     * dying_aliens_ para destruirlo al final del fotograma
      * \post Jugador suma puntos (doble si hay power-up)
      */
     void colision(Alien *a);
 
+    /**
+     * @brief Destruye las entidades eliminadas durante el fotograma
+     *        Se llama al final de update_objects, cuando ya no queda ningún puntero a ellas en
+     *        uso. Cada COMPACT_FRAMES fotogramas libera además los bloques de aliens_, powerups_
+     *        y medkits_ que se han quedado vacíos.
+     * @param window Referencia a la ventana del juego
+     * \post Los aliens de dying_aliens_ están destruidos y su casilla de aliens_ libre
+     */
+    void reclaim_dead(pro2::Window& window);
+
+    /**
+     * @brief Dibuja los contadores de memoria de las entidades (modo depuración)
+     * @param window Referencia a la ventana del juego
+     * @param pos Esquina superior izquierda de los contadores
+     * \post Muestra los aliens vivos y destruidos y los KB que ocupan y que se han liberado
+     */
+    void paint_memory_stats(pro2::Window& window, pro2::Pt pos);
+
     /**
      * @brief Maneja las colisiones con power-ups
-     * \pre Lista de power-ups debe estar inicializada
-     * \post Power-up recolectado es eliminado
+     *        Solo se comprueban los power-ups que devuelve entity_finder_ para el rectángulo del
+     *        jugador, así que el coste no depende del tamaño del mundo.
+     * \pre Cada power-up de entity_finder_ guarda su handle en powerups_ (PowerUp::slot)
+     * \post Power-up recolectado es eliminado (de powerups_ a través de su handle)
      * \post Activa efecto de doble puntos y desactiva los disparos enemigos
      */
     void powerup_collision_();
@@ -185,8 +235,10 @@ class Game {
 
     /**
      * @brief Maneja las colisiones con botiquines
-     * \pre Lista de botiquines debe estar inicializada
-     * \post Botiquín recolectado es eliminado
+     *        Solo se comprueban los botiquines que devuelve entity_finder_ para el rectángulo del
+     *        jugador.
+     * \pre Cada botiquín de entity_finder_ guarda su handle en medkits_ (Medkit::slot)
+     * \post Botiquín recolectado es eliminado (de medkits_ a través de su handle)
      * \post Aumenta hasta el máximo las vidas del jugador
      */
     void medkit_collision_();
@@ -209,6 +261,7 @@ class Game {
 
     /**
      * @brief Comprueba colisiones con balas enemigas
+     *        Se prueba el recorrido de cada bala en el último fotograma (colisión continua).
      * \pre Lista de balas debe estar inicializada
      * \post Reduce vidas si hay colisión
      * \post Elimina balas que impactan al jugador
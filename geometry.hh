@@ -26,6 +26,19 @@ struct Rect {
     int left, top, right, bottom;
 };
 
+/**
+ * @brief Compara dos rectángulos
+ *
+ * Dos rectángulos son iguales si coinciden sus cuatro lados.
+ */
+inline bool operator==(const Rect& a, const Rect& b) {
+    return a.left == b.left && a.top == b.top && a.right == b.right && a.bottom == b.bottom;
+}
+
+inline bool operator!=(const Rect& a, const Rect& b) {
+    return !(a == b);
+}
+
 }  // namespace pro2
 
 #endif
\ No newline at end of file
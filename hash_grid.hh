@@ -0,0 +1,515 @@
+/** @file hash_grid.hh
+ *  @brief Especificación de la clase HashGrid
+ */
+
+#ifndef HASH_GRID_HH
+#define HASH_GRID_HH
+
+#include "finder_stats.hh"
+#include "flat_map.hh"
+#include "utils.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#endif
+
+/** @class HashGrid
+ *  @brief Estructura espacial de Finder basada en una cuadrícula uniforme de cuadrados de N
+ *         píxeles.
+ *
+ *  Los cuadrados se guardan en una tabla de hash de direccionamiento abierto (`FlatMap`) cuya
+ *  clave es la coordenada del cuadrado empaquetada en 64 bits. Cada cuadrado guarda un vector
+ *  contiguo con los identificadores (el handle que les da Finder) y, al lado, una copia de sus
+ *  rectángulos, de forma que el filtro de `intesec_rect` de las consultas recorre memoria lineal.
+ *  Un objeto se registra en todos los cuadrados que toca.
+ *
+ *  El tamaño del cuadrado es un parámetro de plantilla para poder ajustarlo por tipo de objeto
+ *  (ver bench/cell_tuning.cc). Si es potencia de dos, el cálculo del cuadrado es un desplazamiento
+ *  en lugar de una división.
+ *
+ *  Con LAYERS > 1 la cuadrícula guarda varias capas (tipos de objeto, ver LayeredFinder): cada
+ *  cuadrado tiene un vector por capa y la capa de un objeto va en los bits altos de su
+ *  identificador (layer_id()). Las consultas reciben una máscara con las capas que interesan y
+ *  recorren los cuadrados una sola vez para todas ellas.
+ *
+ *  @tparam N Lado en píxeles de los cuadrados de la cuadrícula
+ *  @tparam LAYERS Número de capas
+ */
+template <int N = 100, int LAYERS = 1>
+class HashGrid {
+ public:
+    /// @brief Información que Finder guarda por objeto para esta estructura (no necesita nada).
+    struct Slot {};
+
+    /// @brief Bits bajos del identificador que quedan para el handle dentro de la capa.
+    static const int LAYER_SHIFT = 27;
+
+    /// @brief Máscara con todas las capas.
+    static const uint32_t ALL_LAYERS = (uint32_t(1) << LAYERS) - 1;
+
+    /**
+     * @brief Identificador de un objeto de una capa
+     * \pre 0 <= layer < LAYERS y h < 2^LAYER_SHIFT
+     */
+    static uint32_t layer_id(int layer, uint32_t h) {
+        return (uint32_t(layer) << LAYER_SHIFT) | h;
+    }
+
+    /**
+     * @brief Capa de un identificador
+     * \post Devuelve la capa de id (siempre 0 con una sola capa)
+     */
+    static int layer_of(uint32_t id) {
+        return LAYERS == 1 ? 0 : int(id >> LAYER_SHIFT);
+    }
+
+ private:
+    static_assert(N > 0, "El tamaño de los cuadrados debe ser positivo");
+    static_assert(0 < LAYERS && LAYERS <= 8, "Entre 1 y 8 capas");
+
+    /**
+     * @brief Log2 de N si N es potencia de dos
+     * \post Devuelve k tal que 2^k == N, o -1 si N no es potencia de dos
+     */
+    static constexpr int cell_shift() {
+        if ((N & (N - 1)) != 0) {
+            return -1;
+        }
+        int k = 0;
+        while ((1 << k) < N) {
+            k++;
+        }
+        return k;
+    }
+
+    /**
+     * @class Entry
+     * @brief Objeto registrado en un cuadrado junto con su rectángulo
+     */
+    struct Entry {
+        uint32_t   id;
+        pro2::Rect rect;
+    };
+
+    /**
+     * @class Cell
+     * @brief Cuadrado de la cuadrícula: sus objetos de cada capa y cuántos candidatos han
+     *        comprobado en él las consultas (para las estadísticas)
+     */
+    struct Cell {
+        std::vector<Entry> entries[LAYERS];
+        mutable uint32_t   tested = 0;
+
+        /// @brief Número de objetos del cuadrado en las capas de mask.
+        size_t size(uint32_t mask = ALL_LAYERS) const {
+            size_t n = 0;
+            for (int l = 0; l < LAYERS; ++l) {
+                n += (mask >> l) & 1 ? entries[l].size() : 0;
+            }
+            return n;
+        }
+    };
+
+    /// @brief Tabla que contiene la clave de cada cuadrado y el vector de objetos que pertenecen a
+    /// este cuadrado. Los cuadrados vacíos se conservan para reutilizar su memoria.
+    FlatMap<uint64_t, Cell> pos_map_;
+
+    /// @brief Contadores de las consultas y movimientos.
+    mutable FinderStats stats_;
+
+    /// @brief Rango (en coordenadas de cuadrado) que contiene todos los cuadrados creados; limita
+    /// hasta dónde crece nearest(). Vacío mientras left > right.
+    pro2::Rect used_ = {1, 1, 0, 0};
+
+    /**
+     * @brief Calcula la coordenada de cuadrado de una coordenada del mundo
+     * @param v Coordenada (x o y)
+     * \pre Cierto
+     * \post Devuelve floor(v / N), también para coordenadas negativas
+     */
+    static int n_cell(int v) {
+        if constexpr (cell_shift() >= 0) {
+            // El desplazamiento aritmético ya redondea hacia -infinito
+            return v >> cell_shift();
+        } else {
+            return (v < 0 ? v - N + 1 : v) / N;
+        }
+    }
+
+    /**
+     * @brief Empaqueta la coordenada de un cuadrado como clave de la tabla
+     * \pre Cierto
+     * \post Devuelve una clave única para el cuadrado (cx, cy)
+     */
+    static uint64_t cell_key(int cx, int cy) {
+        return (uint64_t(uint32_t(cx)) << 32) | uint64_t(uint32_t(cy));
+    }
+
+    /**
+     * @brief Calcula el rango de cuadrados que intersecta un rectángulo
+     * @param rect Rectángulo del mundo
+     * \pre Cierto
+     * \post Devuelve el rectángulo (en coordenadas de cuadrado) de los cuadrados que toca rect
+     */
+    static pro2::Rect cell_range(const pro2::Rect& rect) {
+        return {n_cell(rect.left), n_cell(rect.top), n_cell(rect.right), n_cell(rect.bottom)};
+    }
+
+    /**
+     * @brief Comprueba si un cuadrado pertenece a un rango de cuadrados
+     * \post Devuelve true si (cx, cy) está dentro de cells
+     */
+    static bool in_range(const pro2::Rect& cells, int cx, int cy) {
+        return cells.left <= cx && cx <= cells.right && cells.top <= cy && cy <= cells.bottom;
+    }
+
+    /**
+     * @brief Amplía used_ para que contenga un rango de cuadrados
+     * \post used_ contiene cells
+     */
+    void grow_used(const pro2::Rect& cells) {
+        if (used_.left > used_.right) {
+            used_ = cells;
+            return;
+        }
+        used_ = {std::min(used_.left, cells.left), std::min(used_.top, cells.top),
+                 std::max(used_.right, cells.right), std::max(used_.bottom, cells.bottom)};
+    }
+
+    /**
+     * @brief Elimina la entrada de id de un cuadrado (intercambiándola con la última)
+     * \post id ya no aparece en cell; devuelve si estaba
+     */
+    static bool erase_entry(std::vector<Entry>& cell, uint32_t id) {
+        for (size_t i = 0; i < cell.size(); ++i) {
+            if (cell[i].id == id) {
+                cell[i] = cell.back();
+                cell.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+ public:
+    /// @brief Constructora de una cuadrícula vacía.
+    HashGrid() {}
+
+    /**
+     * @brief Añade un objeto en todos los cuadrados que intersecta rect
+     * \pre id no está en los cuadrados de rect
+     * \post id está registrado, con su rectángulo, en cada cuadrado de rect
+     */
+    void insert(uint32_t id, const pro2::Rect& rect, Slot&) {
+        const pro2::Rect cells = cell_range(rect);
+        grow_used(cells);
+        for (int cx = cells.left; cx <= cells.right; ++cx) {
+            for (int cy = cells.top; cy <= cells.bottom; ++cy) {
+                pos_map_[cell_key(cx, cy)].entries[layer_of(id)].push_back({id, rect});
+            }
+        }
+    }
+
+    /**
+     * @brief Añade de golpe n objetos
+     *        Calcula todas las parejas (cuadrado, objeto), las ordena por cuadrado y crea cada
+     *        cuadrado con la capacidad exacta, en lugar de hacer crecer los vectores uno a uno.
+     * @param first Identificador del primer objeto (el de records[i] es first + i)
+     * @param records Registros con miembro rect
+     * \pre Los objetos no están en la cuadrícula y son todos de la capa de first
+     * \post Cada objeto está registrado, con su rectángulo, en cada cuadrado que toca; dentro de
+     * un cuadrado los nuevos objetos quedan por orden de identificador
+     */
+    template <typename Record>
+    void bulk_insert(uint32_t first, Record *records, size_t n) {
+        size_t total = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const pro2::Rect c = cell_range(records[i].rect);
+            total += size_t(c.right - c.left + 1) * size_t(c.bottom - c.top + 1);
+            grow_used(c);
+        }
+        // Parejas (cuadrado, posición en records); se ordenan solo 16 bytes por pareja
+        std::vector<std::pair<uint64_t, uint32_t>> pairs;
+        pairs.reserve(total);
+        for (size_t i = 0; i < n; ++i) {
+            const pro2::Rect cells = cell_range(records[i].rect);
+            for (int cx = cells.left; cx <= cells.right; ++cx) {
+                for (int cy = cells.top; cy <= cells.bottom; ++cy) {
+                    pairs.push_back({cell_key(cx, cy), uint32_t(i)});
+                }
+            }
+        }
+        if (!std::is_sorted(pairs.begin(), pairs.end())) {
+            std::sort(pairs.begin(), pairs.end());
+        }
+
+        size_t n_cells = 0;
+        for (size_t i = 0; i < pairs.size(); ++i) {
+            n_cells += i == 0 || pairs[i].first != pairs[i - 1].first;
+        }
+        pos_map_.reserve(pos_map_.size() + n_cells);
+        for (size_t i = 0; i < pairs.size();) {
+            size_t j = i;
+            while (j < pairs.size() && pairs[j].first == pairs[i].first) {
+                j++;
+            }
+            std::vector<Entry>& cell = pos_map_[pairs[i].first].entries[layer_of(first)];
+            cell.reserve(cell.size() + (j - i));
+            for (; i < j; ++i) {
+                cell.push_back({first + pairs[i].second, records[pairs[i].second].rect});
+            }
+        }
+    }
+
+    /**
+     * @brief Mueve un objeto de los cuadrados de old_rect a los de new_rect
+     *        Si los dos rectángulos tocan los mismos cuadrados solo se actualiza la copia del
+     *        rectángulo; en otro caso se quita de los cuadrados que ya no toca y se añade en los
+     *        nuevos.
+     * \pre id está registrado en los cuadrados de old_rect
+     * \post id está registrado, con new_rect, exactamente en los cuadrados de new_rect
+     */
+    void move(uint32_t id, const pro2::Rect& old_rect, const pro2::Rect& new_rect, Slot&) {
+        const pro2::Rect old_cells = cell_range(old_rect);
+        const pro2::Rect new_cells = cell_range(new_rect);
+
+        for (int cx = old_cells.left; cx <= old_cells.right; ++cx) {
+            for (int cy = old_cells.top; cy <= old_cells.bottom; ++cy) {
+                std::vector<Entry>& entries =
+                    pos_map_.find(cell_key(cx, cy))->entries[layer_of(id)];
+                if (!in_range(new_cells, cx, cy)) {
+                    erase_entry(entries, id);
+                } else {
+                    for (Entry& e : entries) {
+                        if (e.id == id) {
+                            e.rect = new_rect;
+                            break;
+                        }
+                    }
+                }
+            }
+        }
+
+        if (old_cells == new_cells) {
+            return;
+        }
+        stats_.relinks++;
+        grow_used(new_cells);
+        for (int cx = new_cells.left; cx <= new_cells.right; ++cx) {
+            for (int cy = new_cells.top; cy <= new_cells.bottom; ++cy) {
+                if (!in_range(old_cells, cx, cy)) {
+                    pos_map_[cell_key(cx, cy)].entries[layer_of(id)].push_back({id, new_rect});
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Quita un objeto de todos los cuadrados que intersecta rect
+     * \pre id está registrado en los cuadrados de rect
+     * \post id ya no aparece en ninguno de esos cuadrados
+     */
+    void erase(uint32_t id, const pro2::Rect& rect, Slot&) {
+        const pro2::Rect cells = cell_range(rect);
+        for (int cx = cells.left; cx <= cells.right; ++cx) {
+            for (int cy = cells.top; cy <= cells.bottom; ++cy) {
+                Cell *cell = pos_map_.find(cell_key(cx, cy));
+                if (cell != nullptr) {
+                    erase_entry(cell->entries[layer_of(id)], id);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Visita los objetos que intersectan con rect
+     *        Un objeto que ocupa varios cuadrados solo se acepta en el cuadrado que contiene la
+     *        esquina superior izquierda de su intersección con 'rect', así que cada objeto se
+     *        visita una única vez sin construir ningún conjunto.
+     * @param mask Capas que se consultan (bit l para la capa l); por defecto todas
+     * @param visit Función llamada como visit(uint32_t id, const pro2::Rect& rect_id)
+     * \post Se ha llamado a visit una vez por objeto de las capas de mask, por columnas de
+     * cuadrados de izquierda a derecha y, dentro de cada cuadrado, por capas
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, uint32_t mask, F&& visit) const {
+        const pro2::Rect cells = cell_range(rect);
+        uint64_t         accepted = 0;
+        stats_.queries++;
+        for (int cx = cells.left; cx <= cells.right; ++cx) {
+            for (int cy = cells.top; cy <= cells.bottom; ++cy) {
+                stats_.cells_touched++;
+                const Cell *cell = pos_map_.find(cell_key(cx, cy));
+                if (cell == nullptr) {
+                    continue;
+                }
+                const size_t n = cell->size(mask);
+                cell->tested += uint32_t(n);
+                stats_.tested += n;
+                for (int l = 0; l < LAYERS; ++l) {
+                    if (((mask >> l) & 1) == 0) {
+                        continue;
+                    }
+                    for (const Entry& e : cell->entries[l]) {
+                        if (intesec_rect(rect, e.rect) &&
+                            n_cell(std::max(rect.left, e.rect.left)) == cx &&
+                            n_cell(std::max(rect.top, e.rect.top)) == cy) {
+                            accepted++;
+                            visit(e.id, e.rect);
+                        }
+                    }
+                }
+            }
+        }
+        stats_.accepted += accepted;
+    }
+
+    template <typename F>
+    void for_each(const pro2::Rect& rect, F&& visit) const {
+        for_each(rect, ALL_LAYERS, visit);
+    }
+
+    /**
+     * @brief Busca los k objetos más cercanos a un punto
+     *        Recorre los cuadrados por anillos alrededor del cuadrado de p. Un objeto solo se
+     *        comprueba en el cuadrado que contiene su punto más cercano a p (así cada objeto se
+     *        mira una vez aunque ocupe varios cuadrados), y como los objetos no vistos están como
+     *        mínimo a (anillo - 1) · N, la búsqueda se para en cuanto los k mejores están más
+     *        cerca que eso. Nunca se sale de los cuadrados creados.
+     * @param p Punto de referencia
+     * @param k Número de objetos buscados
+     * @param best Vector donde se dejan los resultados (se vacía antes)
+     * @param mask Capas en las que se busca; por defecto todas
+     * \post best contiene, como montículo de máximos, las parejas (distancia al cuadrado, id) de
+     * los min(k, n) objetos de las capas de mask más cercanos a p (a igual distancia, los de
+     * menor id)
+     */
+    void nearest(pro2::Pt p, size_t k, std::vector<std::pair<int64_t, uint32_t>>& best,
+                 uint32_t mask = ALL_LAYERS) const {
+        best.clear();
+        if (k == 0 || used_.left > used_.right) {
+            return;
+        }
+        stats_.queries++;
+        const int pcx = n_cell(p.x);
+        const int pcy = n_cell(p.y);
+        const int last = std::max(std::max(pcx - used_.left, used_.right - pcx),
+                                  std::max(pcy - used_.top, used_.bottom - pcy));
+
+        auto scan = [&](int cx, int cy) {
+            stats_.cells_touched++;
+            const Cell *cell = pos_map_.find(cell_key(cx, cy));
+            if (cell == nullptr) {
+                return;
+            }
+            const size_t n = cell->size(mask);
+            cell->tested += uint32_t(n);
+            stats_.tested += n;
+            for (int l = 0; l < LAYERS; ++l) {
+                if (((mask >> l) & 1) == 0) {
+                    continue;
+                }
+                for (const Entry& e : cell->entries[l]) {
+                    const pro2::Pt q = closest_pt(p, e.rect);
+                    if (n_cell(q.x) != cx || n_cell(q.y) != cy) {
+                        continue;
+                    }
+                    const std::pair<int64_t, uint32_t> cand = {dist2_pt_rect(p, e.rect), e.id};
+                    if (best.size() < k) {
+                        best.push_back(cand);
+                        std::push_heap(best.begin(), best.end());
+                    } else if (cand < best.front()) {
+                        std::pop_heap(best.begin(), best.end());
+                        best.back() = cand;
+                        std::push_heap(best.begin(), best.end());
+                    }
+                }
+            }
+        };
+
+        for (int ring = 0; ring <= last; ++ring) {
+            const int64_t reach = int64_t(ring - 1) * N;
+            if (ring > 0 && best.size() == k && best.front().first <= reach * reach) {
+                break;
+            }
+            // Lados del anillo, recortados a los cuadrados creados
+            const int x0 = std::max(pcx - ring, used_.left), x1 = std::min(pcx + ring, used_.right);
+            const int y0 = std::max(pcy - ring + 1, used_.top);
+            const int y1 = std::min(pcy + ring - 1, used_.bottom);
+            for (int cy : {pcy - ring, pcy + ring}) {
+                if (used_.top <= cy && cy <= used_.bottom) {
+                    for (int cx = x0; cx <= x1; ++cx) {
+                        scan(cx, cy);
+                    }
+                }
+                if (ring == 0) {
+                    break;
+                }
+            }
+            for (int cx : {pcx - ring, pcx + ring}) {
+                if (ring > 0 && used_.left <= cx && cx <= used_.right) {
+                    for (int cy = y0; cy <= y1; ++cy) {
+                        scan(cx, cy);
+                    }
+                }
+            }
+        }
+        stats_.accepted += best.size();
+    }
+
+    /**
+     * @brief Contadores de las consultas y movimientos
+     * \post Devuelve queries, cells_touched, tested, accepted y relinks acumulados
+     */
+    const FinderStats& stats() const {
+        return stats_;
+    }
+
+    /**
+     * @brief Pone a cero los contadores y el coste acumulado de cada cuadrado
+     */
+    void reset_stats() {
+        stats_ = FinderStats();
+        pos_map_.for_each([](uint64_t, Cell& cell) { cell.tested = 0; });
+    }
+
+    /**
+     * @brief Histograma de ocupación de los cuadrados
+     * @param hist Vector donde se deja el histograma (se vacía antes)
+     * \post hist[k] es el número de cuadrados con k objetos (los cuadrados vacíos que se
+     * conservan cuentan en hist[0])
+     */
+    void occupancy(std::vector<size_t>& hist) const {
+        hist.clear();
+        pos_map_.for_each([&hist](uint64_t, const Cell& cell) {
+            if (hist.size() <= cell.size()) {
+                hist.resize(cell.size() + 1, 0);
+            }
+            hist[cell.size()]++;
+        });
+    }
+
+    /**
+     * @brief Visita los cuadrados no vacíos que intersectan con rect (para dibujarlos)
+     * @param visit Función llamada como visit(const pro2::Rect& cell, size_t n_objects,
+     * uint64_t tested), donde tested es el número de candidatos comprobados en el cuadrado
+     * \post Se ha llamado a visit una vez por cuadrado con objetos
+     */
+    template <typename F>
+    void for_each_cell(const pro2::Rect& rect, F&& visit) const {
+        const pro2::Rect cells = cell_range(rect);
+        for (int cx = cells.left; cx <= cells.right; ++cx) {
+            for (int cy = cells.top; cy <= cells.bottom; ++cy) {
+                const Cell *cell = pos_map_.find(cell_key(cx, cy));
+                if (cell != nullptr && cell->size() > 0) {
+                    visit(pro2::Rect{cx * N, cy * N, cx * N + N - 1, cy * N + N - 1},
+                          cell->size(), uint64_t(cell->tested));
+                }
+            }
+        }
+    }
+};
+
+#endif
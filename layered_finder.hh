@@ -0,0 +1,530 @@
+/** @file layered_finder.hh
+ *  @brief Especificación de la clase LayeredFinder
+ */
+
+#ifndef LAYERED_FINDER_HH
+#define LAYERED_FINDER_HH
+
+#include "finder_stats.hh"
+#include "flat_map.hh"
+#include "hash_grid.hh"
+#include "sweep.hh"
+#include "utils.hh"
+#include "visible_set.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#endif
+
+/** @class LayeredFinder
+ *  @brief Índice espacial único para varios tipos de objeto, con una capa por tipo.
+ *
+ *  Todos los tipos comparten una sola cuadrícula (HashGrid con una capa por tipo): cada cuadrado
+ *  guarda un vector por tipo, así que una consulta recorre los cuadrados una sola vez y, dentro de
+ *  cada uno, solo los vectores de los tipos que pide su máscara (mask<...>()). Por ejemplo,
+ *  refresh_visible() rellena los VisibleSet de todos los tipos con un único recorrido de las
+ *  franjas de la cámara, y una pasada de colisiones puede pedir solo algunos tipos.
+ *
+ *  Cada tipo tiene sus propios handles, como en Finder (registros densos con puntero y
+ *  rectángulo, handles libres reutilizados y tabla puntero -> handle). En la cuadrícula el
+ *  identificador de un objeto lleva su capa en los bits altos (HashGrid::layer_id()).
+ *  Las operaciones que solo afectan a un tipo (add, update_many, remove...) deducen la capa del
+ *  tipo del objeto, y layer<T>() da una vista con la interfaz de consulta de Finder (for_each,
+ *  sweep, segment) para ese tipo.
+ *
+ *  Los tipos con movimiento acotado (con get_move_bounds(), como los aliens) se indexan por su
+ *  zona de movimiento, como en StripFinder: mientras un objeto no sale de ella, update() no toca
+ *  la cuadrícula, así que los que oscilan no cambian nunca de cuadrado. Su rectángulo exacto solo
+ *  se pide (get_rect()) para los candidatos de cada consulta. refresh_visible() aplica a cada
+ *  candidato la regla de su VisibleSet: con ExactRect (la de View::for_each) se comprueba su
+ *  rectángulo exacto, y los objetos que se mueven dentro de su zona se vuelven a comprobar a
+ *  través de touch(); con MotionRect basta el rectángulo de la cuadrícula, así que un objeto cuya
+ *  posición se calcula al pedirla (los aliens) no cuesta nada mientras no se consulta.
+ *
+ *  @tparam N Lado en píxeles de los cuadrados de la cuadrícula
+ *  @tparam Ts Tipos de objeto (cada uno con método get_rect()), uno por capa
+ */
+template <int N, typename... Ts>
+class LayeredFinder {
+ public:
+    /// @brief Identificador de un objeto dentro de su capa.
+    typedef uint32_t Handle;
+
+    /// @brief Número de capas.
+    static const int LAYERS = int(sizeof...(Ts));
+
+ private:
+    typedef HashGrid<N, LAYERS> Grid;
+
+    /// @brief Máscara de los bits del handle dentro del identificador de la cuadrícula.
+    static const uint32_t HANDLE_MASK = (uint32_t(1) << Grid::LAYER_SHIFT) - 1;
+
+    /**
+     * @class Layer
+     * @brief Registros de los objetos de un tipo
+     */
+    template <typename T>
+    struct Layer {
+        /**
+         * @class Record
+         * @brief Datos de un objeto (obj == nullptr si el handle está libre)
+         */
+        struct Record {
+            T                  *obj = nullptr;
+            pro2::Rect          rect;  ///< Rectángulo en la cuadrícula (o zona de movimiento)
+            typename Grid::Slot slot;
+        };
+
+        std::vector<Record>  records;  ///< Registros indexados por handle
+        std::vector<Handle>  free;     ///< Handles libres
+        FlatMap<T *, Handle> handles;  ///< Handle de cada objeto
+        std::vector<T *>     moved;    ///< Objetos movidos en el último update_many()
+    };
+
+    /// @brief Registros de cada tipo.
+    std::tuple<Layer<Ts>...> layers_;
+
+    /// @brief Cuadrícula compartida por todas las capas.
+    Grid grid_;
+
+    /// @brief Contadores de altas, bajas y actualizaciones (el resto los cuenta grid_).
+    FinderStats churn_;
+
+    template <typename T>
+    Layer<T>& layer_data() {
+        return std::get<Layer<T>>(layers_);
+    }
+
+    template <typename T>
+    const Layer<T>& layer_data() const {
+        return std::get<Layer<T>>(layers_);
+    }
+
+    /**
+     * @brief Rectángulo con el que se guarda un objeto en la cuadrícula
+     * \post Devuelve la zona de movimiento de t (que incluye su rectángulo actual) si el tipo la
+     * tiene y, si no, su rectángulo
+     */
+    template <typename T>
+    static pro2::Rect indexed_rect(const T& t) {
+        return MotionRect::of(t);
+    }
+
+    /**
+     * @brief Comprueba un candidato de una consulta con su rectángulo exacto
+     * @param r Rectángulo del candidato en la cuadrícula; si el tipo tiene zona de movimiento, se
+     * sustituye por el rectángulo actual del objeto
+     * \post Devuelve true si el objeto intersecta con query
+     */
+    template <typename T>
+    static bool exact_rect(const T *obj, const pro2::Rect& query, pro2::Rect& r) {
+        if constexpr (has_move_bounds<T>::value) {
+            r = obj->get_rect();
+            return intesec_rect(query, r);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Actualiza un objeto ya localizado
+     * \post Devuelve true si el objeto ha cambiado de rectángulo en la cuadrícula (y en ese caso
+     * se ha movido en grid_); un objeto que sigue dentro de su zona de movimiento no se mueve
+     */
+    template <typename T>
+    bool update_record(Handle h, typename Layer<T>::Record& record) {
+        pro2::Rect new_rect = record.obj->get_rect();
+        churn_.updates++;
+        if constexpr (has_move_bounds<T>::value) {
+            const pro2::Rect& b = record.rect;
+            if (b.left <= new_rect.left && new_rect.right <= b.right && b.top <= new_rect.top &&
+                new_rect.bottom <= b.bottom) {
+                return false;
+            }
+            new_rect = indexed_rect(*record.obj);
+        }
+        if (new_rect == record.rect) {
+            return false;
+        }
+        churn_.moves++;
+        const pro2::Rect old_rect = record.rect;
+        record.rect = new_rect;
+        grid_.move(Grid::layer_id(index_of<T>(), h), old_rect, new_rect, record.slot);
+        return true;
+    }
+
+    /**
+     * @brief Llama a visit con el objeto de un identificador de la cuadrícula si intersecta con
+     *        query
+     *        Se compara la capa con la de cada tipo, así que visit se instancia para todos ellos.
+     */
+    template <typename F, size_t... I>
+    void dispatch(uint32_t id, const pro2::Rect& query, pro2::Rect r, F& visit,
+                  std::index_sequence<I...>) const {
+        const int layer = Grid::layer_of(id);
+        ((layer == int(I) ? visit_exact(std::get<I>(layers_).records[id & HANDLE_MASK].obj, query,
+                                        r, visit)
+                          : void()),
+         ...);
+    }
+
+    template <typename T, typename F>
+    static void visit_exact(T *obj, const pro2::Rect& query, pro2::Rect& r, F& visit) {
+        if (exact_rect(obj, query, r)) {
+            visit(obj, r);
+        }
+    }
+
+    /**
+     * @brief Pasa un objeto encontrado por refresh_visible() al VisibleSet de su tipo
+     *        Con ExactRect el candidato se comprueba con su rectángulo exacto, como en
+     *        View::for_each; con MotionRect el rectángulo de la cuadrícula ya es el de la regla.
+     *        Así el conjunto usa la misma regla que en begin_refresh() y end_refresh().
+     * @param query Zona consultada
+     * @param r Rectángulo del objeto en la cuadrícula
+     */
+    template <typename... Us, typename... Rs>
+    void offer(std::tuple<VisibleSet<Us, Rs>&...>& sets, uint32_t id, const pro2::Rect& query,
+               pro2::Rect r, bool entering) const {
+        const int layer = Grid::layer_of(id);
+        ((layer == index_of<Us>() ? offer_rule(std::get<VisibleSet<Us, Rs>&>(sets),
+                                               layer_data<Us>().records[id & HANDLE_MASK].obj,
+                                               query, r, entering)
+                                  : void()),
+         ...);
+    }
+
+    template <typename T, typename Rule>
+    static void offer_rule(VisibleSet<T, Rule>& set, T *obj, const pro2::Rect& query,
+                           pro2::Rect& r, bool entering) {
+        if constexpr (std::is_same<Rule, ExactRect>::value) {
+            if (!exact_rect(obj, query, r)) {
+                return;
+            }
+        }
+        if (entering) {
+            set.found_entering(obj);
+        } else {
+            set.found_leaving(obj, r);
+        }
+    }
+
+    /**
+     * @brief Consulta las zonas de un refresh() para las capas de mask
+     */
+    template <typename... Us, typename... Rs>
+    void scan_strips(const CameraStrips& strips, uint32_t mask,
+                     std::tuple<VisibleSet<Us, Rs>&...>& sets) const {
+        for (int i = 0; i < strips.n_enter; ++i) {
+            grid_.for_each(strips.enter[i], mask, [&](uint32_t id, const pro2::Rect& r) {
+                offer(sets, id, strips.enter[i], r, true);
+            });
+        }
+        for (int i = 0; i < strips.n_leave; ++i) {
+            grid_.for_each(strips.leave[i], mask, [&](uint32_t id, const pro2::Rect& r) {
+                offer(sets, id, strips.leave[i], r, false);
+            });
+        }
+    }
+
+ public:
+    /**
+     * @class View
+     * @brief Vista de una sola capa con la interfaz de consulta de Finder, para usarla con
+     *        VisibleSet::refresh, sweep_index...
+     */
+    template <typename T>
+    class View {
+     private:
+        const LayeredFinder *finder_;
+
+     public:
+        /// @brief Resultado de sweep() y segment().
+        typedef SweepHit<T> Hit;
+
+        explicit View(const LayeredFinder *finder) : finder_(finder) {}
+
+        /**
+         * @brief Visita los objetos de la capa que intersectan con rect
+         *        Los objetos con zona de movimiento se visitan con su rectángulo exacto.
+         * @param visit Función llamada como visit(T *obj, const pro2::Rect& obj_rect)
+         */
+        template <typename F>
+        void for_each(const pro2::Rect& rect, F&& visit) const {
+            const Layer<T>& layer = finder_->template layer_data<T>();
+            finder_->grid_.for_each(rect, mask<T>(),
+                                    [&layer, &rect, &visit](uint32_t id, pro2::Rect r) {
+                                        T *obj = layer.records[id & HANDLE_MASK].obj;
+                                        if (exact_rect(obj, rect, r)) {
+                                            visit(obj, r);
+                                        }
+                                    });
+        }
+
+        /**
+         * @brief Barrido de un rectángulo en movimiento contra la capa, como en Finder::sweep
+         */
+        void sweep(const pro2::Rect& box, pro2::Pt delta, std::vector<Hit>& out) const {
+            sweep_index(*this, box, delta, out);
+        }
+
+        /**
+         * @brief Objetos de la capa que toca el segmento de 'from' a 'to', como en
+         *        Finder::segment
+         */
+        void segment(pro2::Pt from, pro2::Pt to, std::vector<Hit>& out) const {
+            sweep({from.x, from.y, from.x, from.y}, {to.x - from.x, to.y - from.y}, out);
+        }
+    };
+
+    /// @brief Constructora de un índice vacío.
+    LayeredFinder() {}
+
+    /**
+     * @brief Capa de un tipo
+     * \post Devuelve la posición de T en Ts (error de compilación si T no es de Ts)
+     */
+    template <typename T>
+    static constexpr int index_of() {
+        constexpr bool same[] = {std::is_same<T, Ts>::value...};
+        for (int i = 0; i < LAYERS; ++i) {
+            if (same[i]) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    /**
+     * @brief Máscara de consulta con las capas de unos tipos
+     * \post Devuelve la máscara con el bit de la capa de cada tipo de Us
+     */
+    template <typename... Us>
+    static constexpr uint32_t mask() {
+        static_assert(((index_of<Us>() >= 0) && ...), "Tipo sin capa en LayeredFinder");
+        return ((uint32_t(1) << index_of<Us>()) | ...);
+    }
+
+    /**
+     * @brief Vista de consulta de la capa de T
+     */
+    template <typename T>
+    View<T> layer() const {
+        return View<T>(this);
+    }
+
+    /**
+     * @brief Añade un nuevo objeto en su capa
+     * @param t Puntero al objeto a añadir
+     * \pre t debe tener método get_rect() y no estar ya en el índice
+     * \post Se añade el objeto según su rectángulo y se devuelve su handle dentro de su capa
+     */
+    template <typename T>
+    Handle add(T *t) {
+        Layer<T>& layer = layer_data<T>();
+        Handle    h;
+        if (!layer.free.empty()) {
+            h = layer.free.back();
+            layer.free.pop_back();
+        } else {
+            h = Handle(layer.records.size());
+            layer.records.push_back(typename Layer<T>::Record());
+        }
+        typename Layer<T>::Record& record = layer.records[h];
+        record.obj = t;
+        record.rect = indexed_rect(*t);
+        layer.handles[t] = h;
+        grid_.insert(Grid::layer_id(index_of<T>(), h), record.rect, record.slot);
+        churn_.adds++;
+        return h;
+    }
+
+    /**
+     * @brief Añade de golpe muchos objetos de un mismo tipo, como Finder::bulk_build
+     * @param objs Rango con size() de punteros a objetos de uno de los tipos
+     * \pre Los objetos no están ya en el índice
+     * \post Todos los objetos de objs están en su capa, con handles consecutivos
+     */
+    template <typename Range>
+    void bulk_build(const Range& objs) {
+        typedef typename std::remove_pointer<typename Range::value_type>::type T;
+        Layer<T>&    layer = layer_data<T>();
+        const Handle first = Handle(layer.records.size());
+        layer.records.reserve(layer.records.size() + objs.size());
+        layer.handles.reserve(layer.handles.size() + objs.size());
+        for (T *t : objs) {
+            layer.handles[t] = Handle(layer.records.size());
+            layer.records.push_back(typename Layer<T>::Record());
+            layer.records.back().obj = t;
+            layer.records.back().rect = indexed_rect(*t);
+        }
+        grid_.bulk_insert(Grid::layer_id(index_of<T>(), first), layer.records.data() + first,
+                          layer.records.size() - first);
+        churn_.adds += layer.records.size() - first;
+    }
+
+    /**
+     * @brief Consulta el handle de un objeto, como Finder::handle
+     * \post Devuelve true y deja en h el handle de t dentro de su capa si t está en el índice
+     */
+    template <typename T>
+    bool handle(T *t, Handle& h) const {
+        const Handle *found = layer_data<T>().handles.find(t);
+        if (found == nullptr) {
+            return false;
+        }
+        h = *found;
+        return true;
+    }
+
+    /**
+     * @brief Actualiza la posición de un objeto, como Finder::update
+     * \post Devuelve true si el objeto ha cambiado de rectángulo en la cuadrícula y false si no
+     * (también si sigue dentro de su zona de movimiento), o si t no está en el índice
+     */
+    template <typename T>
+    bool update(T *t) {
+        Layer<T>&     layer = layer_data<T>();
+        const Handle *h = layer.handles.find(t);
+        return h != nullptr && update_record<T>(*h, layer.records[*h]);
+    }
+
+    /**
+     * @brief Actualiza de golpe un conjunto de objetos de un mismo tipo, como Finder::update_many
+     * @param objs Rango (por ejemplo un std::vector) de punteros a objetos de uno de los tipos
+     * \post Todos los objetos de objs están actualizados; moved<T>() contiene los que han
+     * cambiado de rectángulo en la cuadrícula
+     */
+    template <typename Range>
+    void update_many(const Range& objs) {
+        typedef typename std::remove_pointer<typename Range::value_type>::type T;
+        Layer<T>& layer = layer_data<T>();
+        layer.moved.clear();
+        for (T *t : objs) {
+            const Handle *h = layer.handles.find(t);
+            if (h != nullptr && update_record<T>(*h, layer.records[*h])) {
+                layer.moved.push_back(t);
+            }
+        }
+    }
+
+    /**
+     * @brief Objetos de tipo T que se movieron en la última llamada a update_many con ese tipo
+     */
+    template <typename T>
+    const std::vector<T *>& moved() const {
+        return layer_data<T>().moved;
+    }
+
+    /**
+     * @brief Elimina un objeto del índice, dado por handle (de la capa de T) o por puntero
+     * \post El objeto ya no está en su capa y su handle queda libre
+     */
+    template <typename T>
+    void remove(Handle h) {
+        Layer<T>& layer = layer_data<T>();
+        if (h >= layer.records.size() || layer.records[h].obj == nullptr) {
+            return;
+        }
+        typename Layer<T>::Record& record = layer.records[h];
+        grid_.erase(Grid::layer_id(index_of<T>(), h), record.rect, record.slot);
+        layer.handles.erase(record.obj);
+        record.obj = nullptr;
+        layer.free.push_back(h);
+        churn_.removes++;
+    }
+
+    template <typename T>
+    void remove(T *t) {
+        const Handle *h = layer_data<T>().handles.find(t);
+        if (h != nullptr) {
+            remove<T>(*h);
+        }
+    }
+
+    /**
+     * @brief Visita los objetos de las capas de mask que intersectan con rect
+     *        Se recorren los cuadrados de rect una sola vez para todas las capas.
+     * @param mask Capas que se consultan (ver mask<...>())
+     * @param visit Función genérica llamada como visit(U *obj, const pro2::Rect& obj_rect), con U
+     * el tipo de cada objeto (por ejemplo una lambda con parámetro auto *)
+     * \post Se ha llamado a visit una vez por objeto de las capas de mask
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, uint32_t mask, F&& visit) const {
+        grid_.for_each(rect, mask, [this, &rect, &visit](uint32_t id, const pro2::Rect& r) {
+            dispatch(id, rect, r, visit, std::index_sequence_for<Ts...>());
+        });
+    }
+
+    /**
+     * @brief Actualiza varios VisibleSet (uno por tipo) con un único recorrido de la cámara
+     *        Si todos los conjuntos tienen que consultar las mismas franjas (lo normal, si
+     *        siempre se actualizan juntos), se recorren una sola vez con la máscara de todos sus
+     *        tipos; si no, cada conjunto recorre las suyas con la máscara de su tipo.
+     * @param camera Rectángulo de la cámara
+     * @param sets Conjuntos de objetos visibles, de tipos de Ts distintos y con cualquier regla
+     * \post Cada conjunto contiene los objetos de su tipo que intersectan con camera según su
+     * regla; con ExactRect, queda como después de sets.refresh(layer<U>(), camera)
+     */
+    template <typename... Us, typename... Rs>
+    void refresh_visible(const pro2::Rect& camera, VisibleSet<Us, Rs>&... sets) const {
+        std::tuple<VisibleSet<Us, Rs>&...> all(sets...);
+        CameraStrips                       strips[sizeof...(Us)];
+        size_t                             i = 0;
+        (sets.begin_refresh(camera, strips[i++]), ...);
+
+        bool same = true;
+        for (size_t j = 1; j < sizeof...(Us); ++j) {
+            same = same && same_strips(strips[0], strips[j]);
+        }
+        if (same) {
+            scan_strips(strips[0], mask<Us...>(), all);
+        } else {
+            i = 0;
+            (scan_strips(strips[i++], mask<Us>(), all), ...);
+        }
+        (sets.end_refresh(), ...);
+    }
+
+    /**
+     * @brief Estadísticas de uso acumuladas de todas las capas, como Finder::stats
+     */
+    FinderStats stats() const {
+        FinderStats s = grid_.stats();
+        s.adds = churn_.adds;
+        s.removes = churn_.removes;
+        s.updates = churn_.updates;
+        s.moves = churn_.moves;
+        return s;
+    }
+
+    /**
+     * @brief Pone a cero las estadísticas
+     */
+    void reset_stats() {
+        churn_ = FinderStats();
+        grid_.reset_stats();
+    }
+
+    /**
+     * @brief Histograma de ocupación de los cuadrados (sumando todas las capas)
+     */
+    void occupancy(std::vector<size_t>& hist) const {
+        grid_.occupancy(hist);
+    }
+
+    /**
+     * @brief Visita los cuadrados no vacíos que tocan 'rect', como Finder::for_each_cell
+     */
+    template <typename F>
+    void for_each_cell(const pro2::Rect& rect, F&& visit) const {
+        grid_.for_each_cell(rect, visit);
+    }
+};
+
+#endif
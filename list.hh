@@ -5,18 +5,66 @@
 #ifndef LIST_HH
 #define LIST_HH
 
+#include "slab_pool.hh"
+
 #ifndef NO_DIAGRAM
 #include <iostream>
+#include <memory>
+#include <new>
 #include <stdexcept>
+#include <type_traits>
+#include <utility>
 #endif
 
 using namespace std;
 
+/**
+ * @class ListChecked
+ * @brief Política de comprobaciones de List que valida cada operación con iteradores (acabar
+ *        de lista, iterador de otra lista...) y acaba el programa con un mensaje si falla
+ */
+struct ListChecked {
+    static constexpr bool ENABLED = true;
+};
+
+/**
+ * @class ListUnchecked
+ * @brief Política de comprobaciones de List sin ninguna validación: los iteradores solo siguen
+ *        punteros (usar un iterador fuera de rango es comportamiento indefinido)
+ */
+struct ListUnchecked {
+    static constexpr bool ENABLED = false;
+};
+
+/// @brief Política por defecto: sin comprobaciones al compilar con NDEBUG (make MODE=release).
+#ifdef NDEBUG
+typedef ListUnchecked ListDefaultChecks;
+#else
+typedef ListChecked ListDefaultChecks;
+#endif
+
 /**
  * @class List
  * @brief Implementación de una lista doblemente enlazada con iteradores
+ *
+ * Los nodos se reservan con la política de memoria Alloc. Por defecto es SlabPool, que saca los
+ * nodos de bloques grandes y contiguos (cada lista tiene el suyo) en lugar de hacer un new por
+ * elemento: la construcción es más rápida, los nodos insertados seguidos quedan juntos al
+ * recorrer la lista y clear() devuelve todos los bloques de golpe. Con HeapAlloc cada nodo se
+ * reserva por separado, como en la versión original.
+ *
+ * Varias listas pueden compartir la reserva de nodos (share_pool(), o automáticamente al hacer
+ * splice() hacia una lista vacía), y entonces se pueden pasar nodos de una a otra con splice()
+ * en O(1) sin reservar ni copiar nada. compact() devuelve a la memoria los bloques que han quedado
+ * sin ningún nodo vivo.
+ *
+ * @tparam T Tipo de los elementos
+ * @tparam Alloc Política de memoria para los nodos (allocate, deallocate, release, bytes, y
+ * BULK_RELEASE si release() libera también los nodos que no se han devuelto)
+ * @tparam Checks Política de comprobaciones de los iteradores (ListChecked o ListUnchecked)
  */
-template <typename T>
+template <typename T, template <typename> class Alloc = SlabPool,
+          typename Checks = ListDefaultChecks>
 class List {
  private:
     /**
@@ -31,12 +79,45 @@ class List {
 
         Item() : next(nullptr), prev(nullptr) {}
 
-        Item(const T& val) : value(val), next(nullptr), prev(nullptr) {}
+        template <typename A, typename... Args>
+        explicit Item(A&& a, Args&&...args)
+            : value(std::forward<A>(a), std::forward<Args>(args)...), next(nullptr),
+              prev(nullptr) {}
     };
 
-    int  _size;
-    Item iteminf, itemsup;
+    int                          _size;
+    Item                         iteminf, itemsup;
+    std::shared_ptr<Alloc<Item>> pool;  // Es nul·la fins al primer element
+
+    Alloc<Item>& alloc()
+    /* Pre: cert */
+    /* Post: el resultat és la reserva de nodes del p.i., que es crea si
+       encara no en té */
+    {
+        if (!pool) {
+            pool = std::make_shared<Alloc<Item>>();
+        }
+        return *pool;
+    }
+
+    bool samePool(const List& l) const
+    /* Pre: cert */
+    /* Post: el resultat diu si els nodes d'l es poden passar al p.i. */
+    {
+        return !Alloc<Item>::BULK_RELEASE || pool == l.pool || l._size == 0;
+    }
 
+    void spliceItems(Item *pitemprev, Item *first, Item *last, int n)
+    /* Pre: first..last són n nodes consecutius ja extrets de la seva
+       llista, pitemprev apunta a un element del p.i. o a iteminf */
+    /* Post: first..last queden enllaçats després de pitemprev */
+    {
+        last->next = pitemprev->next;
+        last->next->prev = last;
+        first->prev = pitemprev;
+        pitemprev->next = first;
+        _size += n;
+    }
     void insertItem(Item *pitemprev, Item *pitem) {
         pitem->next = pitemprev->next;
         pitem->next->prev = pitem;
@@ -45,11 +126,52 @@ class List {
         _size++;
     }
 
-    void insertItem(Item *pitemprev, const T& value) {
-        Item *pitem = new Item(value);
+    template <typename... Args>
+    void emplaceItem(Item *pitemprev, Args&&...args)
+    /* Pre: pitemprev apunta a un element del p.i. o a iteminf */
+    /* Post: s'inserta després de pitemprev un node amb el valor
+       construït a partir de args */
+    {
+        Item *pitem = new (alloc().allocate()) Item(std::forward<Args>(args)...);
         insertItem(pitemprev, pitem);
     }
 
+    void insertItem(Item *pitemprev, const T& value) {
+        emplaceItem(pitemprev, value);
+    }
+
+    void stealItems(List& l)
+    /* Pre: el p.i. és buit */
+    /* Post: el p.i. passa a tenir els nodes i la memòria d'l,
+       i l queda buida */
+    {
+        if (l._size > 0) {
+            iteminf.next = l.iteminf.next;
+            iteminf.next->prev = &iteminf;
+            itemsup.prev = l.itemsup.prev;
+            itemsup.prev->next = &itemsup;
+            _size = l._size;
+            l.iteminf.next = &l.itemsup;
+            l.itemsup.prev = &l.iteminf;
+            l._size = 0;
+        }
+        pool = std::move(l.pool);
+    }
+
+    void adoptPool(List& l)
+    /* Pre: l no és buida */
+    /* Post: si el p.i. és buit i no té reserva, passa a compartir la d'l;
+       si els nodes d'l no es poden passar al p.i. s'acaba el programa */
+    {
+        if (_size == 0 && (!pool || pool.use_count() == 1)) {
+            pool = l.pool;
+        }
+        if (!samePool(l)) {
+            cerr << "Error: moving nodes between lists with different pools" << endl;
+            exit(1);
+        }
+    }
+
     void extractItem(Item *pitem)
     /* Pre: pitem != & iteminf, pitem != &itemsup
        pitem apunta a un element del p.i. */
@@ -67,19 +189,38 @@ class List {
        a pitem, s'allibera la memòria del node apuntat per pitem */
     {
         extractItem(pitem);
-        delete pitem;
+        pitem->~Item();
+        pool->deallocate(pitem);
     }
 
     void removeItems() {
         /* Pre: _size = S */
         /* Post: s'ha alliberat la memòria dels S nodes entre iteminf i itemsup,
            iteminf.next = &itemsup, itemsup.prev = &iteminf, _size = 0*/
-        while (_size > 0) {
-            removeItem(iteminf.next);
+        if (!pool) {
+            return;
+        }
+        // Si la reserva és només del p.i. es pot alliberar sencera de cop
+        const bool bulk = Alloc<Item>::BULK_RELEASE && pool.use_count() == 1;
+        if (!std::is_trivially_destructible<T>::value || !bulk) {
+            for (Item *pitem = iteminf.next; pitem != &itemsup;) {
+                Item *pnext = pitem->next;
+                pitem->~Item();
+                if (!bulk) {
+                    pool->deallocate(pitem);
+                }
+                pitem = pnext;
+            }
+        }
+        iteminf.next = &itemsup;
+        itemsup.prev = &iteminf;
+        _size = 0;
+        if (pool.use_count() == 1) {
+            pool->release();
         }
     }
 
-    void copyItems(List& l) {
+    void copyItems(const List& l) {
         /* Pre: cert*/
         /* Post: copia els elements de la llista l al p.i. */
         for (Item *pitem = l.itemsup.prev; pitem != &l.iteminf; pitem = pitem->prev) {
@@ -99,7 +240,7 @@ class List {
         itemsup.prev = &iteminf;
     }
 
-    List(List& l)
+    List(const List& l)
     /* Pre: cert */
     /* Post: El resultat és una còpia d’l */
     {
@@ -109,6 +250,18 @@ class List {
         copyItems(l);
     }
 
+    List(List&& l) noexcept
+    /* Pre: cert */
+    /* Post: El resultat té els elements d'l, sense copiar-los ni
+       moure'ls de lloc, i l queda buida. Els iteradors d'l deixen
+       de ser vàlids */
+    {
+        _size = 0;
+        iteminf.next = &itemsup;
+        itemsup.prev = &iteminf;
+        stealItems(l);
+    }
+
     ~List()
     // Destructora: Esborra automàticament els objectes locals en
     // sortir d’un àmbit de visibilitat
@@ -131,6 +284,19 @@ class List {
         return *this;
     }
 
+    List& operator=(List&& l) noexcept
+    /* Pre: cert */
+    /* Post: El p.i. passa a tenir els elements d'l, sense copiar-los,
+       qualsevol contingut anterior del p.i. ha estat esborrat i l queda
+       buida (excepte si el p.i. i l ja eren el mateix objecte) */
+    {
+        if (this != &l) {
+            removeItems();
+            stealItems(l);
+        }
+        return *this;
+    }
+
     // Standard operations:
 
     int size() const
@@ -163,11 +329,45 @@ class List {
         insertItem(&iteminf, value);
     }
 
+    void push_back(T&& value)
+    /* Pre: cert */
+    /* Post: s'inserta al final del p.i. un node amb el valor mogut des de value */
+    {
+        emplaceItem(itemsup.prev, std::move(value));
+    }
+
+    void push_front(T&& value)
+    /* Pre: cert */
+    /* Post: s'inserta al principi del p.i. un node amb el valor mogut des de value */
+    {
+        emplaceItem(&iteminf, std::move(value));
+    }
+
+    template <typename... Args>
+    T& emplace_back(Args&&...args)
+    /* Pre: cert */
+    /* Post: s'inserta al final del p.i. un node amb el valor construït
+       directament a partir de args; el resultat és una referència al valor */
+    {
+        emplaceItem(itemsup.prev, std::forward<Args>(args)...);
+        return itemsup.prev->value;
+    }
+
+    template <typename... Args>
+    T& emplace_front(Args&&...args)
+    /* Pre: cert */
+    /* Post: s'inserta al principi del p.i. un node amb el valor construït
+       directament a partir de args; el resultat és una referència al valor */
+    {
+        emplaceItem(&iteminf, std::forward<Args>(args)...);
+        return iteminf.next->value;
+    }
+
     void pop_back()
     /* Pre: el p.i. no és buit */
     /* Post: s'esborra el primer node del p.i. */
     {
-        if (_size == 0) {
+        if (Checks::ENABLED && _size == 0) {
             cerr << "Error: pop_back on empty list" << endl;
             exit(1);
         }
@@ -178,7 +378,7 @@ class List {
     /* Pre: el p.i. no és buit */
     /* Post: s'esborra el darrer node del p.i. */
     {
-        if (_size == 0) {
+        if (Checks::ENABLED && _size == 0) {
             cerr << "Error: pop_front on empty list" << endl;
             exit(1);
         }
@@ -207,20 +407,88 @@ class List {
 
     void clear()
     /* Pre: el p.i pot ser buit o no */
-    /* Post: elimina tots els elements de la llista */
+    /* Post: elimina tots els elements de la llista i allibera
+       de cop la memòria dels seus nodes */
+    {
+        removeItems();
+    }
+
+    size_t memory_bytes() const
+    /* Pre: cert */
+    /* Post: el resultat és la memòria reservada per als nodes del p.i.
+       (de tota la reserva, si la comparteix amb altres llistes) */
     {
-        while (_size > 0) {
-            removeItem(iteminf.next);
+        return pool ? pool->bytes() : 0;
+    }
+
+    void share_pool(List& l)
+    /* Pre: el p.i. és buit */
+    /* Post: el p.i. i l fan servir la mateixa reserva de nodes, de
+       manera que splice() pot passar nodes d'una a l'altra */
+    {
+        if (Checks::ENABLED && _size != 0) {
+            cerr << "Error: share_pool on a non-empty list" << endl;
+            exit(1);
+        }
+        pool = l.pool ? l.pool : (l.pool = std::make_shared<Alloc<Item>>());
+    }
+
+    size_t compact()
+    /* Pre: cert */
+    /* Post: els blocs de la reserva de nodes que no tenen cap node viu
+       s'han tornat a la memòria; el resultat és el nombre de bytes
+       alliberats */
+    {
+        return pool ? pool->trim() : 0;
+    }
+
+    template <typename P>
+    int remove_if(P pred)
+    /* Pre: cert */
+    /* Post: s'han esborrat, en una sola passada, els elements del p.i. que
+       compleixen pred; el resultat és el nombre d'elements esborrats */
+    {
+        int removed = 0;
+        for (Item *pitem = iteminf.next; pitem != &itemsup;) {
+            Item *pnext = pitem->next;
+            if (pred(pitem->value)) {
+                removeItem(pitem);
+                removed++;
+            }
+            pitem = pnext;
+        }
+        return removed;
+    }
+
+    template <typename P>
+    void partition(P pred, List& rejected)
+    /* Pre: rejected comparteix la reserva del p.i. o és buida i no
+       comparteix la seva amb cap altra llista */
+    /* Post: en una sola passada, els elements del p.i. que no compleixen
+       pred s'han mogut (sense copiar-los) al final de rejected, en el
+       mateix ordre; els que la compleixen es queden al p.i. */
+    {
+        if (&rejected == this || _size == 0) {
+            return;
+        }
+        rejected.adoptPool(*this);
+        for (Item *pitem = iteminf.next; pitem != &itemsup;) {
+            Item *pnext = pitem->next;
+            if (!pred(pitem->value)) {
+                extractItem(pitem);
+                rejected.spliceItems(rejected.itemsup.prev, pitem, pitem, 1);
+            }
+            pitem = pnext;
         }
     }
 
     // Read and write:
 
-    template <typename U>
-    friend istream& operator>>(istream& is, List<U>& l);
+    template <typename U, template <typename> class A, typename C>
+    friend istream& operator>>(istream& is, List<U, A, C>& l);
 
-    template <typename U>
-    friend ostream& operator<<(ostream& os, List<U>& l);
+    template <typename U, template <typename> class A, typename C>
+    friend ostream& operator<<(ostream& os, List<U, A, C>& l);
 
     // Iterators mutables
     /**
@@ -242,7 +510,7 @@ class List {
         /* Post: el p.i apunta a l'element següent a E
            el resultat és el p.i. */
         {
-            if (pitem == &(plist->itemsup)) {
+            if (Checks::ENABLED && pitem == &(plist->itemsup)) {
                 cerr << "Error: ++ on iterator at the end of list" << endl;
                 exit(1);
             }
@@ -270,7 +538,7 @@ class List {
         /* Post: el p.i apunta a l'element anterior a E,
            el resultat és el p.i. */
         {
-            if (pitem == plist->iteminf.next) {
+            if (Checks::ENABLED && pitem == plist->iteminf.next) {
                 cerr << "Error: --iterator at the beginning of list" << endl;
                 exit(1);
             }
@@ -295,7 +563,7 @@ class List {
            que no és el end() */
         /* Post: el resultat és el valor de l'element E */
         {
-            if (pitem == &(plist->itemsup)) {
+            if (Checks::ENABLED && pitem == &(plist->itemsup)) {
                 cerr << "Error: ++iterator at the end of list" << endl;
                 exit(1);
             }
@@ -348,7 +616,7 @@ class List {
        de l'element al que apunta it i el resultat
        apunta al nou element inserit */
     {
-        if (it.plist != this) {
+        if (Checks::ENABLED && it.plist != this) {
             cout << "Error: insert with an iterator not on this list" << endl;
             exit(1);
         }
@@ -358,17 +626,44 @@ class List {
         return res;
     }
 
+    iterator insert(iterator it, T&& value)
+    /* Pre: it ha d'apuntar a un element del p.i
+       o a l'element fictici end() del p.i */
+    /* Post: s'inserta un element amb el valor mogut des de value abans
+       de l'element al que apunta it i el resultat apunta al nou element */
+    {
+        return emplace(it, std::move(value));
+    }
+
+    template <typename... Args>
+    iterator emplace(iterator it, Args&&...args)
+    /* Pre: it ha d'apuntar a un element del p.i
+       o a l'element fictici end() del p.i */
+    /* Post: s'inserta abans de l'element al que apunta it un element
+       construït directament a partir de args i el resultat apunta al
+       nou element inserit */
+    {
+        if (Checks::ENABLED && it.plist != this) {
+            cerr << "Error: emplace with an iterator not on this list" << endl;
+            exit(1);
+        }
+        iterator res = it;
+        emplaceItem(res.pitem->prev, std::forward<Args>(args)...);
+        res.pitem = res.pitem->prev;
+        return res;
+    }
+
     iterator erase(iterator it)
     /* Pre: it ha d'apuntar a un element del p.i
        que no sigui l'end() */
     /* Post: s'elimina l'element apuntat per it, el
        resultat apunta a l'element posterior a l'eliminat */
     {
-        if (it.plist != this) {
+        if (Checks::ENABLED && it.plist != this) {
             cout << "Error: erase with an iterator not on this list" << endl;
             exit(1);
         }
-        if (it.pitem == &itemsup) {
+        if (Checks::ENABLED && it.pitem == &itemsup) {
             cout << "Error: erase with an iterator pointing to the end of the list" << endl;
             exit(1);
         }
@@ -378,6 +673,48 @@ class List {
         return res;
     }
 
+    void splice(iterator pos, List& l)
+    /* Pre: pos apunta a un element del p.i. o a end(); l és una altra
+       llista que comparteix la reserva del p.i. (o el p.i. és buit) */
+    /* Post: tots els elements d'l s'han mogut, sense copiar-los, abans de
+       pos en O(1); l queda buida */
+    {
+        if (&l == this || l._size == 0) {
+            return;
+        }
+        if (Checks::ENABLED && pos.plist != this) {
+            cerr << "Error: splice with an iterator not on this list" << endl;
+            exit(1);
+        }
+        adoptPool(l);
+        Item *first = l.iteminf.next;
+        Item *last = l.itemsup.prev;
+        const int n = l._size;
+        l.iteminf.next = &l.itemsup;
+        l.itemsup.prev = &l.iteminf;
+        l._size = 0;
+        spliceItems(pos.pitem->prev, first, last, n);
+    }
+
+    void splice(iterator pos, List& l, iterator it)
+    /* Pre: pos apunta a un element del p.i. o a end(); it apunta a un
+       element d'l que no és l'end(); l comparteix la reserva del p.i.
+       (o el p.i. és buit) */
+    /* Post: l'element d'it s'ha mogut, sense copiar-lo, abans de pos en
+       O(1) */
+    {
+        if (Checks::ENABLED && (pos.plist != this || it.plist != &l || it.pitem == &l.itemsup)) {
+            cerr << "Error: splice with an iterator not on its list" << endl;
+            exit(1);
+        }
+        if (it.pitem == pos.pitem || it.pitem->next == pos.pitem) {
+            return;
+        }
+        adoptPool(l);
+        l.extractItem(it.pitem);
+        spliceItems(pos.pitem->prev, it.pitem, it.pitem, 1);
+    }
+
     // Iteradors constants
 
     /**
@@ -399,7 +736,7 @@ class List {
         /* Post: el p.i apunta a l'element següent a E,
            el resultat és el p.i. */
         {
-            if (pitem == &(plist->itemsup)) {
+            if (Checks::ENABLED && pitem == &(plist->itemsup)) {
                 cerr << "Error: ++iterator at the end of list" << endl;
                 exit(1);
             }
@@ -414,7 +751,7 @@ class List {
         /* Post: el p.i apunta a l'element següent a E,
            el resultat és I */
         {
-            if (pitem == &(plist->itemsup)) {
+            if (Checks::ENABLED && pitem == &(plist->itemsup)) {
                 cerr << "Error: iterator++ at the end of list" << endl;
                 exit(1);
             }
@@ -430,7 +767,7 @@ class List {
         /* Post: el p.i apunta a l'element anterior a E,
            el resultat és el p.i. */
         {
-            if (pitem == plist->iteminf.next) {
+            if (Checks::ENABLED && pitem == plist->iteminf.next) {
                 cerr << "Error: --iterator at the beginning of list" << endl;
                 exit(1);
             }
@@ -445,7 +782,7 @@ class List {
         /* Post: el p.i apunta a l'element anterior a E,
            el resultat és I */
         {
-            if (pitem == plist->iteminf.next) {
+            if (Checks::ENABLED && pitem == plist->iteminf.next) {
                 cerr << "Error: iterator-- at the beginning of list" << endl;
                 exit(1);
             }
@@ -521,7 +858,7 @@ class List {
        de l'element al que apunta it i el resultat
        apunta al nou element inserit */
     {
-        if (it.plist != this) {
+        if (Checks::ENABLED && it.plist != this) {
             cout << "Error: insert with an iterator not on this list" << endl;
             exit(1);
         }
@@ -537,11 +874,11 @@ class List {
     /* Post: s'elimina l'element apuntat per it, el
        resultat apunta a l'element posterior a l'eliminat */
     {
-        if (it.plist != this) {
+        if (Checks::ENABLED && it.plist != this) {
             cout << "Error: erase with an iterator not on this list" << endl;
             exit(1);
         }
-        if (it.pitem == &itemsup) {
+        if (Checks::ENABLED && it.pitem == &itemsup) {
             cout << "Error: erase with an iterator pointing to the end of the list" << endl;
             exit(1);
         }
@@ -554,8 +891,8 @@ class List {
 
 // Implementation of read and write lists.
 
-template <typename T>
-istream& operator>>(istream& is, List<T>& l) {
+template <typename T, template <typename> class Alloc, typename Checks>
+istream& operator>>(istream& is, List<T, Alloc, Checks>& l) {
     l.removeItems();
     int size;
     cin >> size;
@@ -567,10 +904,11 @@ istream& operator>>(istream& is, List<T>& l) {
     return is;
 }
 
-template <typename T>
-ostream& operator<<(ostream& os, List<T>& l) {
+template <typename T, template <typename> class Alloc, typename Checks>
+ostream& operator<<(ostream& os, List<T, Alloc, Checks>& l) {
     os << l._size;
-    for (typename List<T>::Item *pitem = l.iteminf.next; pitem != &l.itemsup; pitem = pitem->next) {
+    for (typename List<T, Alloc, Checks>::Item *pitem = l.iteminf.next; pitem != &l.itemsup;
+         pitem = pitem->next) {
         cout << " " << pitem->value;
     }
     return os;
@@ -0,0 +1,303 @@
+/** @file loose_quadtree.hh
+ *  @brief Especificación de la clase LooseQuadtree
+ */
+
+#ifndef LOOSE_QUADTREE_HH
+#define LOOSE_QUADTREE_HH
+
+#include "finder_stats.hh"
+#include "flat_map.hh"
+#include "utils.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#endif
+
+/** @class LooseQuadtree
+ *  @brief Estructura espacial de Finder basada en un quadtree holgado (loose quadtree).
+ *
+ *  El nivel L del árbol divide el plano en nodos cuadrados de lado S = BASE·2^L. Cada objeto se
+ *  guarda en un único nodo: el del nivel más pequeño en el que cabe (su lado mayor es <= S) y
+ *  que contiene su centro. Como el objeto puede sobresalir hasta S/2 de su nodo, los límites de
+ *  cada nodo son holgados (lado 2S), y una consulta mira en cada nivel los nodos cuyos límites
+ *  holgados tocan el rectángulo. Así los objetos muy anchos no se repiten en muchas casillas
+ *  (como en la cuadrícula) y cada objeto se visita una sola vez.
+ *
+ *  Los nodos no vacíos se guardan en una tabla de hash indexada por (nivel, x, y), de forma que
+ *  el árbol no necesita conocer los límites del mundo ni guardar nodos intermedios vacíos. Cada
+ *  nodo guarda el identificador de sus objetos (el handle que les da Finder).
+ *
+ *  @tparam BASE Lado en píxeles de los nodos del nivel 0
+ */
+template <int BASE = 64>
+class LooseQuadtree {
+ public:
+    /// @brief Información que Finder guarda por objeto: la clave del nodo en el que está.
+    struct Slot {
+        uint64_t node = 0;
+    };
+
+ private:
+    /// @brief Número máximo de niveles
+    static const int LEVELS = 24;
+
+    /**
+     * @class Entry
+     * @brief Objeto guardado en un nodo junto con su rectángulo
+     */
+    struct Entry {
+        uint32_t   id;
+        pro2::Rect rect;
+    };
+
+    /**
+     * @class Node
+     * @brief Nodo del árbol: sus objetos y cuántos candidatos han comprobado en él las consultas
+     */
+    struct Node {
+        std::vector<Entry> entries;
+        mutable uint32_t   tested = 0;
+    };
+
+    /// @brief Nodos no vacíos indexados por su clave (nivel, x, y).
+    FlatMap<uint64_t, Node> nodes_;
+
+    /// @brief Contadores de las consultas y movimientos.
+    mutable FinderStats stats_;
+
+    /// @brief Número de objetos de cada nivel, para saltar los niveles vacíos en las consultas.
+    int count_[LEVELS] = {};
+
+    /**
+     * @brief División entera redondeando hacia -infinito
+     * \pre d > 0
+     */
+    static int floor_div(int v, int d) {
+        return (v < 0 ? v - d + 1 : v) / d;
+    }
+
+    /**
+     * @brief Empaqueta la posición de un nodo como clave de la tabla
+     * \post Devuelve una clave única para el nodo (level, ix, iy)
+     */
+    static uint64_t node_key(int level, int ix, int iy) {
+        return (uint64_t(level) << 58) | ((uint64_t(uint32_t(ix)) & 0x1FFFFFFF) << 29) |
+               (uint64_t(uint32_t(iy)) & 0x1FFFFFFF);
+    }
+
+    /**
+     * @brief Nivel de un nodo a partir de su clave
+     */
+    static int key_level(uint64_t key) {
+        return int(key >> 58);
+    }
+
+    /**
+     * @brief Calcula el nodo en el que se guarda un rectángulo
+     * \post Devuelve la clave del nodo más pequeño en el que cabe rect y contiene su centro
+     */
+    static uint64_t node_of(const pro2::Rect& rect) {
+        const int extent = std::max(rect.right - rect.left, rect.bottom - rect.top);
+        int       level = 0;
+        while (level < LEVELS - 1 && (BASE << level) < extent) {
+            level++;
+        }
+        const int size = BASE << level;
+        const int cx = floor_div(rect.left + rect.right, 2);
+        const int cy = floor_div(rect.top + rect.bottom, 2);
+        return node_key(level, floor_div(cx, size), floor_div(cy, size));
+    }
+
+    /**
+     * @brief Elimina la entrada de id de un nodo (intercambiándola con la última)
+     * \post id ya no aparece en el nodo
+     */
+    static void erase_entry(std::vector<Entry>& entries, uint32_t id) {
+        for (size_t i = 0; i < entries.size(); ++i) {
+            if (entries[i].id == id) {
+                entries[i] = entries.back();
+                entries.pop_back();
+                return;
+            }
+        }
+    }
+
+ public:
+    /// @brief Constructora de un árbol vacío.
+    LooseQuadtree() {}
+
+    /**
+     * @brief Añade un objeto en su nodo
+     * \post id está en el nodo de rect y slot guarda la clave de ese nodo
+     */
+    void insert(uint32_t id, const pro2::Rect& rect, Slot& slot) {
+        slot.node = node_of(rect);
+        nodes_[slot.node].entries.push_back({id, rect});
+        count_[key_level(slot.node)]++;
+    }
+
+    /**
+     * @brief Añade de golpe n objetos
+     *        Calcula el nodo de cada objeto, los ordena por nodo y crea cada nodo con la capacidad
+     *        exacta.
+     * @param first Identificador del primer objeto (el de records[i] es first + i)
+     * @param records Registros con miembros rect y slot
+     * \pre Los objetos no están en el árbol
+     * \post Cada objeto está en su nodo y su slot guarda la clave del nodo
+     */
+    template <typename Record>
+    void bulk_insert(uint32_t first, Record *records, size_t n) {
+        std::vector<std::pair<uint64_t, uint32_t>> order(n);
+        for (size_t i = 0; i < n; ++i) {
+            records[i].slot.node = node_of(records[i].rect);
+            order[i] = {records[i].slot.node, uint32_t(i)};
+            count_[key_level(records[i].slot.node)]++;
+        }
+        std::sort(order.begin(), order.end());
+        for (size_t i = 0; i < n;) {
+            size_t j = i;
+            while (j < n && order[j].first == order[i].first) {
+                j++;
+            }
+            std::vector<Entry>& entries = nodes_[order[i].first].entries;
+            entries.reserve(entries.size() + (j - i));
+            for (; i < j; ++i) {
+                entries.push_back({first + order[i].second, records[order[i].second].rect});
+            }
+        }
+    }
+
+    /**
+     * @brief Mueve un objeto a su nuevo rectángulo
+     *        Si sigue perteneciendo al mismo nodo solo se actualiza la copia del rectángulo.
+     * \pre id está en el nodo slot.node
+     * \post id está en el nodo de new_rect con new_rect
+     */
+    void move(uint32_t id, const pro2::Rect&, const pro2::Rect& new_rect, Slot& slot) {
+        const uint64_t node = node_of(new_rect);
+        if (node == slot.node) {
+            for (Entry& e : nodes_.find(node)->entries) {
+                if (e.id == id) {
+                    e.rect = new_rect;
+                    break;
+                }
+            }
+            return;
+        }
+        stats_.relinks++;
+        erase(id, new_rect, slot);
+        insert(id, new_rect, slot);
+    }
+
+    /**
+     * @brief Quita un objeto de su nodo
+     * \pre id está en el nodo slot.node
+     * \post id ya no está en el árbol
+     */
+    void erase(uint32_t id, const pro2::Rect&, Slot& slot) {
+        erase_entry(nodes_.find(slot.node)->entries, id);
+        count_[key_level(slot.node)]--;
+    }
+
+    /**
+     * @brief Visita los objetos que intersectan con rect
+     *        Para cada nivel con objetos recorre los nodos cuyos límites holgados tocan rect.
+     * @param visit Función llamada como visit(uint32_t id, const pro2::Rect& rect_id)
+     * \post Se ha llamado a visit una vez por objeto, por niveles de menor a mayor
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, F&& visit) const {
+        uint64_t accepted = 0;
+        stats_.queries++;
+        for (int level = 0; level < LEVELS; ++level) {
+            if (count_[level] == 0) {
+                continue;
+            }
+            const int size = BASE << level;
+            const int half = size / 2;
+            const int x0 = floor_div(rect.left - half, size);
+            const int x1 = floor_div(rect.right + half, size);
+            const int y0 = floor_div(rect.top - half, size);
+            const int y1 = floor_div(rect.bottom + half, size);
+            for (int ix = x0; ix <= x1; ++ix) {
+                for (int iy = y0; iy <= y1; ++iy) {
+                    stats_.cells_touched++;
+                    const Node *node = nodes_.find(node_key(level, ix, iy));
+                    if (node == nullptr) {
+                        continue;
+                    }
+                    node->tested += uint32_t(node->entries.size());
+                    stats_.tested += node->entries.size();
+                    for (const Entry& e : node->entries) {
+                        if (intesec_rect(rect, e.rect)) {
+                            accepted++;
+                            visit(e.id, e.rect);
+                        }
+                    }
+                }
+            }
+        }
+        stats_.accepted += accepted;
+    }
+
+    /**
+     * @brief Contadores de las consultas y movimientos
+     * \post Devuelve queries, cells_touched, tested, accepted y relinks acumulados
+     */
+    const FinderStats& stats() const {
+        return stats_;
+    }
+
+    /**
+     * @brief Pone a cero los contadores y el coste acumulado de cada nodo
+     */
+    void reset_stats() {
+        stats_ = FinderStats();
+        nodes_.for_each([](uint64_t, Node& node) { node.tested = 0; });
+    }
+
+    /**
+     * @brief Histograma de ocupación de los nodos
+     * @param hist Vector donde se deja el histograma (se vacía antes)
+     * \post hist[k] es el número de nodos con k objetos (los nodos vaciados cuentan en hist[0])
+     */
+    void occupancy(std::vector<size_t>& hist) const {
+        hist.clear();
+        nodes_.for_each([&hist](uint64_t, const Node& node) {
+            if (hist.size() <= node.entries.size()) {
+                hist.resize(node.entries.size() + 1, 0);
+            }
+            hist[node.entries.size()]++;
+        });
+    }
+
+    /**
+     * @brief Visita los nodos no vacíos cuyo cuadrado (sin holgura) intersecta con rect
+     * @param visit Función llamada como visit(const pro2::Rect& node, size_t n_objects,
+     * uint64_t tested), donde tested es el número de candidatos comprobados en el nodo
+     * \post Se ha llamado a visit una vez por nodo con objetos, por niveles de menor a mayor
+     */
+    template <typename F>
+    void for_each_cell(const pro2::Rect& rect, F&& visit) const {
+        for (int level = 0; level < LEVELS; ++level) {
+            if (count_[level] == 0) {
+                continue;
+            }
+            const int size = BASE << level;
+            for (int ix = floor_div(rect.left, size); ix <= floor_div(rect.right, size); ++ix) {
+                for (int iy = floor_div(rect.top, size); iy <= floor_div(rect.bottom, size); ++iy) {
+                    const Node *node = nodes_.find(node_key(level, ix, iy));
+                    if (node != nullptr && !node->entries.empty()) {
+                        visit(pro2::Rect{ix * size, iy * size, ix * size + size - 1,
+                                         iy * size + size - 1},
+                              node->entries.size(), uint64_t(node->tested));
+                    }
+                }
+            }
+        }
+    }
+};
+
+#endif
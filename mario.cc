@@ -145,9 +145,10 @@ void Mario::jump() {
 void Mario::restart_last_pos() {
     pos_.x = last_grounded_x_platform_;
     pos_.y = last_grounded_platform_->top() - 30;
+    last_pos_ = pos_;
 }
 
-void Mario::update(pro2::Window& window, const std::set<Platform *>& platforms) {
+void Mario::update(pro2::Window& window, const StripFinder<Platform>& platforms) {
     last_pos_ = pos_;
     if (window.is_key_down(jump_key_)) {
         jump();
@@ -167,7 +168,10 @@ void Mario::update(pro2::Window& window, const std::set<Platform *>& platforms)
 
     set_grounded(false);
 
-    for (Platform *platform : platforms) {
+    // Los candidatos llegan ordenados por el instante en que los pies los tocan
+    platforms.segment(last_pos_, pos_, floor_hits_);
+    for (const StripFinder<Platform>::Hit& hit : floor_hits_) {
+        Platform *platform = hit.obj;
         if (platform->has_crossed_floor_downwards(last_pos_, pos_)) {
             set_grounded(true);
             set_y(platform->top());
@@ -176,6 +180,7 @@ void Mario::update(pro2::Window& window, const std::set<Platform *>& platforms)
             if (platform->is_moving()) {
                 pos_.y += platform->get_move_speed() * platform->get_move_direction();
             }
+            break;
         }
     }
 }
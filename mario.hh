@@ -6,11 +6,12 @@
 #define MARIO_HH
 
 #include "platform.hh"
+#include "strip_finder.hh"
 #include "window.hh"
 
 #ifndef NO_DIAGRAM
 #include <iostream>
-#include <set>
+#include <vector>
 #endif
 
 /** @class Mario
@@ -40,6 +41,9 @@ class Mario {
     Platform *last_grounded_platform_;
     int       last_grounded_x_platform_;
 
+    /// @brief Plataformas que cruza el recorrido de los pies en update() (se reutiliza).
+    std::vector<StripFinder<Platform>::Hit> floor_hits_;
+
     /**
      * @brief Aplica física básica al personaje
      * @pre El personaje debe estar inicializado
@@ -158,13 +162,16 @@ class Mario {
 
     /**
      * @brief Actualiza el estado del personaje
+     *        La colisión con el suelo es continua: se consulta el segmento que recorren los pies
+     *        en este fotograma y se aterriza en la primera plataforma que cruza, de forma que a
+     *        cualquier velocidad de caída no se atraviesa ninguna.
      * @param window Ventana para entrada
-     * @param platforms Plataformas para colisión
+     * @param platforms Índice de plataformas para colisión
      * \pre Ventana y plataformas deben estar inicializadas
      * \post Procesa entrada del usuario
      * \post Aplica física y detecta colisiones
      */
-    void update(pro2::Window& window, const std::set<Platform *>& platforms);
+    void update(pro2::Window& window, const StripFinder<Platform>& platforms);
 
     /**
      * @brief Comprueba si está cayendo
@@ -196,7 +203,8 @@ class Mario {
     /**
      * @brief Reinicia a posición segura
      * \pre Debe haber una plataforma de respaldo
-     * \post Coloca al jugador sobre última plataforma segura
+     * \post Coloca al jugador sobre última plataforma segura (sin recorrido desde la posición
+     * anterior)
      */
     void restart_last_pos();
 
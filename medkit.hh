@@ -6,6 +6,7 @@
 #ifndef MEDKIT_HH
 #define MEDKIT_HH
 
+#include "slot_map.hh"
 #include "utils.hh"
 #include "vides_list.hh"
 
@@ -23,6 +24,7 @@ class Medkit {
  private:
     pro2::Pt         position_;
     bool             active_;
+    SlotHandle       slot_;
     static const int WIDTH = 10;
     static const int HEIGHT = 10;
 
@@ -74,6 +76,21 @@ class Medkit {
     void apply_effect(VidesList& vides) const {
         vides.restore();
     }
+
+    /**
+     * @brief Handle del botiquín en el SlotMap que lo guarda
+     */
+    SlotHandle slot() const {
+        return slot_;
+    }
+
+    /**
+     * @brief Guarda el handle del botiquín en el SlotMap que lo guarda
+     * \post slot() == h
+     */
+    void set_slot(SlotHandle h) {
+        slot_ = h;
+    }
 };
 
 #endif
\ No newline at end of file
@@ -325,6 +325,11 @@ void paint_scaled_sprite(pro2::Window&              window,
         paint_sprite(window, top_left, sprite, mirror);
         return;
     }
+    pro2::Rect bounds = {top_left.x, top_left.y, top_left.x + DEFAULT_SPRITE_SIZE * scale - 1,
+                         top_left.y + DEFAULT_SPRITE_SIZE * scale - 1};
+    if (!window.clip(bounds)) {
+        return;
+    }
     for (int y = 0; y < DEFAULT_SPRITE_SIZE; ++y) {
         for (int x = 0; x < DEFAULT_SPRITE_SIZE; ++x) {
             int actual_x = mirror ? DEFAULT_SPRITE_SIZE - 1 - x : x;
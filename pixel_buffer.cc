@@ -0,0 +1,225 @@
+/** @file pixel_buffer.cc
+ *  @brief Implementación de las operaciones de buffers de píxeles
+ */
+
+#include "pixel_buffer.hh"
+
+#ifndef NO_DIAGRAM
+#include <cstring>
+#include <new>
+#endif
+
+#ifdef PRO2_PIXELS_X86
+#include <immintrin.h>
+#endif
+
+namespace pro2 {
+
+uint32_t *alloc_pixels(size_t n) {
+    return static_cast<uint32_t *>(
+        ::operator new(n * sizeof(uint32_t), std::align_val_t(PIXEL_ALIGN)));
+}
+
+void free_pixels(uint32_t *pixels) {
+    if (pixels != nullptr) {
+        ::operator delete(pixels, std::align_val_t(PIXEL_ALIGN));
+    }
+}
+
+void fill_pixels_scalar(uint32_t *dst, size_t n, uint32_t color) {
+    for (size_t i = 0; i < n; i++) {
+        dst[i] = color;
+    }
+}
+
+void expand_row_scalar(const uint32_t *src, int width, uint32_t *dst, int zoom) {
+    for (int i = 0; i < width; i++) {
+        for (int k = 0; k < zoom; k++) {
+            *dst++ = src[i];
+        }
+    }
+}
+
+#ifdef PRO2_PIXELS_X86
+
+// Las dos versiones siguen el mismo esquema: píxeles sueltos hasta llegar a una dirección
+// alineada al tamaño del registro, bloques de 64 bytes (una línea de caché entera, que es lo que
+// aprovechan las escrituras que no pasan por la caché), registros sueltos y píxeles sueltos al
+// final.
+
+__attribute__((target("sse2"))) void fill_pixels_sse2(uint32_t *dst, size_t n, uint32_t color,
+                                                      bool stream) {
+    while (n > 0 && (reinterpret_cast<uintptr_t>(dst) & 15) != 0) {
+        *dst++ = color;
+        n--;
+    }
+    const __m128i v = _mm_set1_epi32(int(color));
+    size_t        i = 0;
+    if (stream) {
+        for (; i + 16 <= n; i += 16) {
+            _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i), v);
+            _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i + 4), v);
+            _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i + 8), v);
+            _mm_stream_si128(reinterpret_cast<__m128i *>(dst + i + 12), v);
+        }
+        _mm_sfence();
+    } else {
+        for (; i + 16 <= n; i += 16) {
+            _mm_store_si128(reinterpret_cast<__m128i *>(dst + i), v);
+            _mm_store_si128(reinterpret_cast<__m128i *>(dst + i + 4), v);
+            _mm_store_si128(reinterpret_cast<__m128i *>(dst + i + 8), v);
+            _mm_store_si128(reinterpret_cast<__m128i *>(dst + i + 12), v);
+        }
+    }
+    for (; i + 4 <= n; i += 4) {
+        _mm_store_si128(reinterpret_cast<__m128i *>(dst + i), v);
+    }
+    for (; i < n; i++) {
+        dst[i] = color;
+    }
+}
+
+__attribute__((target("avx2"))) void fill_pixels_avx2(uint32_t *dst, size_t n, uint32_t color,
+                                                      bool stream) {
+    while (n > 0 && (reinterpret_cast<uintptr_t>(dst) & 31) != 0) {
+        *dst++ = color;
+        n--;
+    }
+    const __m256i v = _mm256_set1_epi32(int(color));
+    size_t        i = 0;
+    if (stream) {
+        for (; i + 16 <= n; i += 16) {
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i), v);
+            _mm256_stream_si256(reinterpret_cast<__m256i *>(dst + i + 8), v);
+        }
+        _mm_sfence();
+    } else {
+        for (; i + 16 <= n; i += 16) {
+            _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i), v);
+            _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i + 8), v);
+        }
+    }
+    for (; i + 8 <= n; i += 8) {
+        _mm256_store_si256(reinterpret_cast<__m256i *>(dst + i), v);
+    }
+    for (; i < n; i++) {
+        dst[i] = color;
+    }
+    // Evita la penalización de mezclar AVX con código SSE compilado sin VEX
+    _mm256_zeroupper();
+}
+
+// Para zoom 2 se duplican los píxeles de un registro entero con una permutación. Para los demás
+// zooms que caben en un registro se escribe un registro con el píxel repetido en cada posición
+// i * zoom: el píxel siguiente sobrescribe lo que sobra, y los últimos píxeles de la fila (cuyo
+// registro se saldría de la fila) se amplían con la versión escalar.
+
+__attribute__((target("sse2"))) void expand_row_sse2(const uint32_t *src, int width, uint32_t *dst,
+                                                     int zoom) {
+    int i = 0;
+    if (zoom == 2) {
+        for (; i + 4 <= width; i += 4) {
+            const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i),
+                             _mm_unpacklo_epi32(v, v));
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + 2 * i + 4),
+                             _mm_unpackhi_epi32(v, v));
+        }
+    } else if (zoom > 2 && zoom <= 4) {
+        const int last = width - (4 + zoom - 1) / zoom;  // Primer píxel que se saldría
+        for (; i < last; i++) {
+            _mm_storeu_si128(reinterpret_cast<__m128i *>(dst + i * zoom),
+                             _mm_set1_epi32(int(src[i])));
+        }
+    }
+    expand_row_scalar(src + i, width - i, dst + i * zoom, zoom);
+}
+
+__attribute__((target("avx2"))) void expand_row_avx2(const uint32_t *src, int width, uint32_t *dst,
+                                                     int zoom) {
+    int i = 0;
+    if (zoom == 2) {
+        const __m256i lo = _mm256_setr_epi32(0, 0, 1, 1, 2, 2, 3, 3);
+        const __m256i hi = _mm256_setr_epi32(4, 4, 5, 5, 6, 6, 7, 7);
+        for (; i + 8 <= width; i += 8) {
+            const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(src + i));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 2 * i),
+                                _mm256_permutevar8x32_epi32(v, lo));
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + 2 * i + 8),
+                                _mm256_permutevar8x32_epi32(v, hi));
+        }
+    } else if (zoom > 2 && zoom <= 8) {
+        const int last = width - (8 + zoom - 1) / zoom;
+        for (; i < last; i++) {
+            _mm256_storeu_si256(reinterpret_cast<__m256i *>(dst + i * zoom),
+                                _mm256_set1_epi32(int(src[i])));
+        }
+    }
+    _mm256_zeroupper();
+    expand_row_scalar(src + i, width - i, dst + i * zoom, zoom);
+}
+
+bool cpu_has_avx2() {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+}
+
+#endif
+
+/**
+ * @class FillImpl
+ * @brief Versiones de fill_pixels y de la ampliación de filas elegidas para esta CPU
+ */
+struct FillImpl {
+    void (*fill)(uint32_t *, size_t, uint32_t, bool);
+    void (*expand_row)(const uint32_t *, int, uint32_t *, int);
+    const char *name;
+};
+
+/// @brief fill_pixels_scalar con la misma signatura que las versiones vectoriales.
+static void fill_scalar(uint32_t *dst, size_t n, uint32_t color, bool) {
+    fill_pixels_scalar(dst, n, color);
+}
+
+/// @brief Elige la versión de fill_pixels la primera vez que se llama.
+static const FillImpl& fill_impl() {
+    static const FillImpl impl = []() -> FillImpl {
+#ifdef PRO2_PIXELS_X86
+        if (cpu_has_avx2()) {
+            return {fill_pixels_avx2, expand_row_avx2, "avx2"};
+        }
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("sse2")) {
+            return {fill_pixels_sse2, expand_row_sse2, "sse2"};
+        }
+#endif
+        return {fill_scalar, expand_row_scalar, "scalar"};
+    }();
+    return impl;
+}
+
+void fill_pixels(uint32_t *dst, size_t n, uint32_t color) {
+    fill_impl().fill(dst, n, color, n * sizeof(uint32_t) >= STREAM_MIN_BYTES);
+}
+
+void upscale_pixels(const uint32_t *src, int width, int height, uint32_t *dst, int zoom) {
+    if (zoom == 1) {
+        memcpy(dst, src, size_t(width) * height * sizeof(uint32_t));
+        return;
+    }
+    const FillImpl& impl = fill_impl();
+    const size_t    row = size_t(width) * zoom;
+    for (int y = 0; y < height; y++) {
+        uint32_t *first = dst + size_t(y) * zoom * row;
+        impl.expand_row(src + size_t(y) * width, width, first, zoom);
+        for (int k = 1; k < zoom; k++) {
+            memcpy(first + k * row, first, row * sizeof(uint32_t));
+        }
+    }
+}
+
+const char *fill_pixels_impl() {
+    return fill_impl().name;
+}
+
+}  // namespace pro2
@@ -0,0 +1,103 @@
+/** @file pixel_buffer.hh
+ *  @brief Reserva y relleno de buffers de píxeles (usados por Window)
+ */
+
+#ifndef PIXEL_BUFFER_HH
+#define PIXEL_BUFFER_HH
+
+#ifndef NO_DIAGRAM
+#include <cstddef>
+#include <cstdint>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+/// @brief Hay versiones SSE2 y AVX2 de las operaciones de píxeles (se eligen al ejecutar).
+#define PRO2_PIXELS_X86 1
+#endif
+
+namespace pro2 {
+
+/// @brief Alineación en bytes del principio de los buffers de píxeles (una línea de caché).
+const size_t PIXEL_ALIGN = 64;
+
+/**
+ * @brief Reserva un buffer de píxeles
+ * @param n Número de píxeles
+ * \post Devuelve memoria sin inicializar para n píxeles, alineada a PIXEL_ALIGN bytes
+ */
+uint32_t *alloc_pixels(size_t n);
+
+/**
+ * @brief Libera un buffer de píxeles
+ * \pre pixels viene de alloc_pixels o es nullptr
+ */
+void free_pixels(uint32_t *pixels);
+
+/**
+ * @brief Rellena n píxeles con un color
+ *        Usa la mejor versión que admite la CPU (AVX2, SSE2 o escalar), elegida la primera vez
+ *        que se llama. En buffers muy grandes (a partir de STREAM_MIN_BYTES) escribe sin pasar
+ *        por la caché, ya que el buffer no cabe.
+ * \post Los píxeles [dst, dst + n) valen color
+ */
+void fill_pixels(uint32_t *dst, size_t n, uint32_t color);
+
+/**
+ * @brief Amplía una imagen repitiendo cada píxel (vecino más próximo)
+ *        Amplía cada fila una sola vez (con la versión AVX2, SSE2 o escalar, como fill_pixels) y
+ *        copia la fila ampliada en las zoom - 1 filas siguientes.
+ * @param src Imagen de width x height píxeles
+ * @param dst Imagen de (width * zoom) x (height * zoom) píxeles
+ * \pre zoom >= 1, src y dst no se solapan
+ * \post Cada píxel (x, y) de src ocupa el cuadrado de zoom x zoom píxeles de dst que empieza en
+ * (x * zoom, y * zoom)
+ */
+void upscale_pixels(const uint32_t *src, int width, int height, uint32_t *dst, int zoom);
+
+/**
+ * @brief Nombre de la versión de fill_pixels y upscale_pixels que se usa en esta CPU
+ * \post Devuelve "avx2", "sse2" o "scalar"
+ */
+const char *fill_pixels_impl();
+
+/**
+ * @brief Tamaño a partir del cual fill_pixels escribe sin pasar por la caché
+ *        Mientras el buffer cabe en la caché de último nivel, las escrituras normales son más
+ *        rápidas y dejan el buffer en la caché para pintar encima (ver bench/clear_bench). La
+ *        ventana del juego (480x320 con zoom 2) ocupa 2,4 MB, así que solo se usan a partir de
+ *        zoom 5.
+ */
+const size_t STREAM_MIN_BYTES = 16 * 1024 * 1024;
+
+/// @brief Versión escalar de fill_pixels (un píxel por iteración).
+void fill_pixels_scalar(uint32_t *dst, size_t n, uint32_t color);
+
+/**
+ * @brief Amplía una fila de píxeles (versión escalar)
+ * \post dst[i * zoom + k] = src[i] para 0 <= i < width y 0 <= k < zoom
+ */
+void expand_row_scalar(const uint32_t *src, int width, uint32_t *dst, int zoom);
+
+#ifdef PRO2_PIXELS_X86
+/// @brief Versión SSE2 de fill_pixels (4 píxeles por escritura); stream indica si se escribe
+/// sin pasar por la caché.
+void fill_pixels_sse2(uint32_t *dst, size_t n, uint32_t color, bool stream);
+
+/// @brief Versión AVX2 de fill_pixels (8 píxeles por escritura).
+/// \pre La CPU admite AVX2 (cpu_has_avx2())
+void fill_pixels_avx2(uint32_t *dst, size_t n, uint32_t color, bool stream);
+
+/// @brief Versión SSE2 de expand_row_scalar (para zoom de 2 a 4; si no, usa la escalar).
+void expand_row_sse2(const uint32_t *src, int width, uint32_t *dst, int zoom);
+
+/// @brief Versión AVX2 de expand_row_scalar (para zoom de 2 a 8; si no, usa la escalar).
+/// \pre La CPU admite AVX2 (cpu_has_avx2())
+void expand_row_avx2(const uint32_t *src, int width, uint32_t *dst, int zoom);
+
+/// @brief Indica si la CPU admite AVX2.
+bool cpu_has_avx2();
+#endif
+
+}  // namespace pro2
+
+#endif
@@ -24,11 +24,20 @@ const vector<vector<int>> Platform::platform_texture_ = {
 // clang-format on
 
 void Platform::paint(pro2::Window& window) const {
+    pro2::Rect rect = {left_, top_ + 1, right_, bottom_};
+    if (!window.clip(rect)) {
+        return;
+    }
     const int xsz = platform_texture_.size();
     const int ysz = platform_texture_[0].size();
-    for (int i = top_ + 1; i <= bottom_; i++) {
-        for (int j = left_; j <= right_; j++) {
-            window.set_pixel({j, i}, platform_texture_[(i - top_ - 1) % xsz][(j - left_) % ysz]);
+    for (int i = rect.top; i <= rect.bottom; i++) {
+        const vector<int>& line = platform_texture_[(i - top_ - 1) % xsz];
+        // La textura se repite cada ysz columnas: se pinta por tramos alineados con ella
+        for (int j = rect.left; j <= rect.right;) {
+            const int phase = (j - left_) % ysz;
+            const int n = min(ysz - phase, rect.right - j + 1);
+            window.blit_span({j, i}, line.data() + phase, n);
+            j += n;
         }
     }
 }
@@ -45,7 +54,7 @@ bool Platform::is_pt_inside(pro2::Pt pt) const {
 void Platform::start_moving() {
     if (!is_moving_) {
         is_moving_ = true;
-        initial_top_ = top_ - 50;
+        initial_top_ = top_ - move_range_;
     }
 }
 
@@ -109,6 +109,17 @@ class Platform {
         return {left_, top_, right_, bottom_};
     }
 
+    /**
+     * @brief Obtiene la zona que puede llegar a ocupar la plataforma
+     * @return Rectángulo que contiene todas las posiciones por las que pasa la plataforma al
+     * oscilar, tanto si ya se mueve como si todavía está quieta
+     */
+    pro2::Rect get_move_bounds() const {
+        int min_top = is_moving_ ? initial_top_ : top_ - move_range_;
+        int max_top = min_top + move_range_ + move_speed_;
+        return {left_, min_top, right_, max_top + (bottom_ - top_)};
+    }
+
     /**
      * @brief Actualiza el estado de la plataforma
      * \post Si la plataforma está en movimiento, actualiza su posición según
@@ -7,6 +7,7 @@
 #define POWERUP_HH
 
 #include "paintsprites.hh"
+#include "slot_map.hh"
 
 #ifndef NO_DIAGRAM
 #include <iostream>
@@ -27,9 +28,10 @@
  */
 class PowerUp {
  private:
-    pro2::Pt position_;
-    bool     collected_;
-    int      frames_remaining_;
+    pro2::Pt   position_;
+    bool       collected_;
+    int        frames_remaining_;
+    SlotHandle slot_;
 
  public:
     static constexpr int DURATION_FRAMES = 600;  ///< Duración en fotogramas del efecto del power-up
@@ -75,6 +77,21 @@ class PowerUp {
      * @return Rectángulo que define el área de colisión
      */
     pro2::Rect get_rect() const;
+
+    /**
+     * @brief Handle del power-up en el SlotMap que lo guarda
+     */
+    SlotHandle slot() const {
+        return slot_;
+    }
+
+    /**
+     * @brief Guarda el handle del power-up en el SlotMap que lo guarda
+     * \post slot() == h
+     */
+    void set_slot(SlotHandle h) {
+        slot_ = h;
+    }
 };
 
 #endif
\ No newline at end of file
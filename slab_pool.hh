@@ -0,0 +1,293 @@
+/** @file slab_pool.hh
+ *  @brief Especificación e implementación de las políticas de memoria de List (SlabPool y
+ *         HeapAlloc)
+ */
+
+#ifndef SLAB_POOL_HH
+#define SLAB_POOL_HH
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+#endif
+
+/**
+ * @class SlabPool
+ * @brief Reserva de memoria para objetos de un solo tipo, sacados de bloques grandes y contiguos.
+ *
+ * Los objetos se reparten de forma consecutiva dentro del último bloque (cada bloque nuevo tiene
+ * el doble de casillas que el anterior, hasta MAX_BLOCK), así que los que se reservan seguidos
+ * quedan juntos en memoria. Las casillas devueltas con deallocate() se guardan en una lista de
+ * libres dentro de la propia casilla y se reutilizan antes de seguir avanzando en el bloque.
+ * release() devuelve todos los bloques de golpe.
+ *
+ * Es la política de memoria por defecto de List (ver también HeapAlloc).
+ *
+ * @tparam U Tipo de los objetos
+ */
+template <typename U>
+class SlabPool {
+ private:
+    /**
+     * @class Slot
+     * @brief Casilla de un bloque: un objeto o, si está libre, el enlace a la siguiente libre
+     */
+    union Slot {
+        Slot *next;
+        alignas(U) unsigned char storage[sizeof(U)];
+    };
+
+    /// @brief Casillas del primer bloque.
+    static constexpr size_t FIRST_BLOCK = 64;
+
+    /// @brief Máximo de casillas por bloque.
+    static constexpr size_t MAX_BLOCK = 4096;
+
+    /**
+     * @class Block
+     * @brief Bloque de casillas contiguas
+     */
+    struct Block {
+        Slot  *slots;
+        size_t size;
+    };
+
+    std::vector<Block> blocks_;
+    Slot              *free_ = nullptr;  ///< Lista de casillas libres
+    size_t             used_ = 0;        ///< Casillas ya repartidas del último bloque
+    size_t             block_size_ = 0;  ///< Casillas del último bloque
+    size_t             capacity_ = 0;    ///< Casillas de todos los bloques
+    size_t             live_ = 0;        ///< Casillas ocupadas
+
+    /**
+     * @brief Añade un bloque nuevo
+     * \post El último bloque tiene el doble de casillas que el anterior (como mucho MAX_BLOCK) y
+     * no se ha repartido ninguna
+     */
+    void grow() {
+        block_size_ = block_size_ == 0 ? FIRST_BLOCK : std::min(2 * block_size_, MAX_BLOCK);
+        blocks_.push_back({new Slot[block_size_], block_size_});
+        capacity_ += block_size_;
+        used_ = 0;
+    }
+
+ public:
+    /// @brief release() libera también las casillas ocupadas.
+    static constexpr bool BULK_RELEASE = true;
+
+    SlabPool() {}
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    /**
+     * @brief Constructora por movimiento
+     * \post El resultado tiene los bloques de o, que queda vacía
+     */
+    SlabPool(SlabPool&& o) noexcept {
+        *this = std::move(o);
+    }
+
+    /**
+     * @brief Asignación por movimiento
+     * \pre Los objetos reservados en el parámetro implícito se han destruido
+     * \post El parámetro implícito pasa a tener los bloques de o, que queda vacía
+     */
+    SlabPool& operator=(SlabPool&& o) noexcept {
+        if (this != &o) {
+            release();
+            blocks_.swap(o.blocks_);
+            std::swap(free_, o.free_);
+            std::swap(used_, o.used_);
+            std::swap(block_size_, o.block_size_);
+            std::swap(capacity_, o.capacity_);
+            std::swap(live_, o.live_);
+        }
+        return *this;
+    }
+
+    ~SlabPool() {
+        release();
+    }
+
+    /**
+     * @brief Reserva memoria para un objeto
+     * \post Devuelve memoria sin inicializar para un U (hay que construirlo con placement new)
+     */
+    U *allocate() {
+        live_++;
+        if (free_ != nullptr) {
+            Slot *slot = free_;
+            free_ = slot->next;
+            return reinterpret_cast<U *>(slot->storage);
+        }
+        if (used_ == block_size_) {
+            grow();
+        }
+        return reinterpret_cast<U *>(blocks_.back().slots[used_++].storage);
+    }
+
+    /**
+     * @brief Devuelve la memoria de un objeto
+     * \pre p viene de allocate() de esta reserva y el objeto ya se ha destruido
+     * \post La casilla de p queda libre para el siguiente allocate()
+     */
+    void deallocate(U *p) {
+        Slot *slot = reinterpret_cast<Slot *>(p);
+        slot->next = free_;
+        free_ = slot;
+        live_--;
+    }
+
+    /**
+     * @brief Libera todos los bloques de golpe, incluidas las casillas que no se han devuelto
+     * \pre Todos los objetos reservados se han destruido
+     * \post La reserva está vacía y no ocupa memoria
+     */
+    void release() {
+        for (const Block& block : blocks_) {
+            delete[] block.slots;
+        }
+        blocks_.clear();
+        free_ = nullptr;
+        used_ = block_size_ = capacity_ = live_ = 0;
+    }
+
+    /**
+     * @brief Devuelve a la memoria los bloques sin ningún objeto vivo
+     *        Cuenta las casillas libres de cada bloque recorriendo la lista de libres una vez y
+     *        vuelve a construirla solo con las casillas de los bloques que se quedan. El último
+     *        bloque (del que todavía se reparten casillas nuevas) solo se libera si no queda
+     *        ningún objeto vivo.
+     * \post Devuelve el número de bytes liberados
+     */
+    size_t trim() {
+        if (live_ == 0) {
+            const size_t freed = bytes();
+            release();
+            return freed;
+        }
+        // Bloques ordenados por dirección para encontrar el de cada casilla libre
+        std::vector<std::pair<Slot *, size_t>> order;  // (casillas, posición en blocks_)
+        order.reserve(blocks_.size());
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            order.push_back({blocks_[b].slots, b});
+        }
+        std::sort(order.begin(), order.end());
+        auto block_of = [&order](Slot *slot) {
+            auto it = std::upper_bound(order.begin(), order.end(), std::make_pair(slot, SIZE_MAX));
+            return (it - 1)->second;
+        };
+        std::vector<size_t> n_free(blocks_.size(), 0);
+        for (Slot *slot = free_; slot != nullptr; slot = slot->next) {
+            n_free[block_of(slot)]++;
+        }
+
+        size_t            freed = 0;
+        std::vector<bool> drop(blocks_.size(), false);
+        for (size_t b = 0; b + 1 < blocks_.size(); ++b) {
+            if (n_free[b] == blocks_[b].size) {
+                drop[b] = true;
+                freed += blocks_[b].size * sizeof(Slot);
+                capacity_ -= blocks_[b].size;
+            }
+        }
+        if (freed == 0) {
+            return 0;
+        }
+        Slot *old_free = free_;
+        free_ = nullptr;
+        for (Slot *slot = old_free; slot != nullptr;) {
+            Slot *next = slot->next;
+            if (!drop[block_of(slot)]) {
+                slot->next = free_;
+                free_ = slot;
+            }
+            slot = next;
+        }
+        std::vector<Block> kept;
+        for (size_t b = 0; b < blocks_.size(); ++b) {
+            if (drop[b]) {
+                delete[] blocks_[b].slots;
+            } else {
+                kept.push_back(blocks_[b]);
+            }
+        }
+        blocks_.swap(kept);
+        return freed;
+    }
+
+    /**
+     * @brief Memoria reservada
+     * \post Devuelve el número de bytes de todos los bloques
+     */
+    size_t bytes() const {
+        return capacity_ * sizeof(Slot);
+    }
+
+    /**
+     * @brief Objetos vivos
+     * \post Devuelve el número de casillas ocupadas
+     */
+    size_t live() const {
+        return live_;
+    }
+};
+
+/**
+ * @class HeapAlloc
+ * @brief Política de memoria de List que reserva cada objeto por separado en el heap (el
+ *        comportamiento original de List, útil para comparar con SlabPool)
+ *
+ * @tparam U Tipo de los objetos
+ */
+template <typename U>
+class HeapAlloc {
+ private:
+    size_t live_ = 0;
+
+ public:
+    /// @brief release() no libera nada: cada objeto se tiene que devolver con deallocate().
+    static constexpr bool BULK_RELEASE = false;
+
+    HeapAlloc() {}
+
+    HeapAlloc(HeapAlloc&& o) noexcept : live_(o.live_) {
+        o.live_ = 0;
+    }
+
+    HeapAlloc& operator=(HeapAlloc&& o) noexcept {
+        std::swap(live_, o.live_);
+        return *this;
+    }
+
+    U *allocate() {
+        live_++;
+        return static_cast<U *>(::operator new(sizeof(U)));
+    }
+
+    void deallocate(U *p) {
+        ::operator delete(p);
+        live_--;
+    }
+
+    void release() {}
+
+    size_t trim() {
+        return 0;
+    }
+
+    size_t bytes() const {
+        return live_ * sizeof(U);
+    }
+
+    size_t live() const {
+        return live_;
+    }
+};
+
+#endif
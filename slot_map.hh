@@ -0,0 +1,351 @@
+/** @file slot_map.hh
+ *  @brief Especificación e implementación de la clase SlotMap
+ */
+
+#ifndef SLOT_MAP_HH
+#define SLOT_MAP_HH
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <utility>
+#include <vector>
+#endif
+
+/**
+ * @class SlotHandle
+ * @brief Referencia a un objeto de un SlotMap: índice de su casilla y generación del objeto
+ *
+ * Es independiente del tipo de los objetos para que ellos mismos puedan guardar su handle.
+ */
+struct SlotHandle {
+    uint32_t index = 0;       ///< Casilla del objeto
+    uint32_t generation = 0;  ///< Generación de la casilla cuando se insertó el objeto
+
+    bool operator==(const SlotHandle& o) const {
+        return index == o.index && generation == o.generation;
+    }
+
+    bool operator!=(const SlotHandle& o) const {
+        return !(*this == o);
+    }
+};
+
+/**
+ * @class SlotMap
+ * @brief Contenedor de objetos con direcciones estables y handles con generación.
+ *
+ * Los objetos se guardan en casillas de bloques de CHUNK casillas contiguas que nunca se mueven,
+ * así que un puntero a un objeto es válido hasta que se borra (los índices espaciales guardan
+ * punteros). Insertar y borrar son O(1): las casillas borradas se reutilizan antes de usar
+ * casillas nuevas, de forma que los objetos vivos quedan agrupados al principio y recorrerlos
+ * es una pasada lineal por memoria contigua, saltando las casillas libres.
+ *
+ * Cada casilla tiene una generación que aumenta al borrar su objeto. Un Handle guarda el índice
+ * de la casilla y la generación del objeto, así que un handle de un objeto ya borrado no da acceso
+ * al objeto que ocupe después su casilla (get() devuelve nullptr).
+ *
+ * compact() libera los bloques que se han quedado sin ningún objeto (sin mover los demás). Si
+ * más adelante hacen falta casillas, se vuelven a crear antes de añadir bloques nuevos, con una
+ * generación mayor que cualquiera de las que tenían, para que los handles antiguos sigan sin
+ * ser válidos.
+ *
+ * @tparam T Tipo de los objetos
+ */
+template <typename T>
+class SlotMap {
+ public:
+    typedef SlotHandle Handle;
+
+ private:
+    /// @brief Casillas por bloque.
+    static constexpr size_t CHUNK = 256;
+
+    /**
+     * @class Slot
+     * @brief Casilla: espacio para un objeto, su generación y si está ocupada
+     */
+    struct Slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+        uint32_t                 generation = 0;
+        bool                     alive = false;
+
+        T *obj() {
+            return reinterpret_cast<T *>(storage);
+        }
+
+        const T *obj() const {
+            return reinterpret_cast<const T *>(storage);
+        }
+    };
+
+    std::vector<std::unique_ptr<Slot[]>> chunks_;  ///< nullptr si compact() lo ha liberado
+    std::vector<uint32_t>                live_;   ///< Objetos vivos de cada bloque
+    std::vector<size_t>                  empty_;  ///< Bloques liberados por compact()
+    std::vector<uint32_t>                free_;   ///< Casillas libres (se reutilizan en orden LIFO)
+    size_t                               used_ = 0;   ///< Casillas usadas alguna vez
+    size_t                               size_ = 0;   ///< Objetos vivos
+    uint32_t                             floor_ = 0;  ///< Generación de las casillas nuevas
+
+    /**
+     * @brief Crea las casillas del bloque c
+     * \pre chunks_[c] es nullptr
+     * \post El bloque c existe, con todas sus casillas libres y con generación floor_
+     */
+    void make_chunk(size_t c) {
+        chunks_[c].reset(new Slot[CHUNK]);
+        for (size_t k = 0; k < CHUNK; ++k) {
+            chunks_[c][k].generation = floor_;
+        }
+        live_[c] = 0;
+    }
+
+    Slot& slot(size_t i) {
+        return chunks_[i / CHUNK][i % CHUNK];
+    }
+
+    const Slot& slot(size_t i) const {
+        return chunks_[i / CHUNK][i % CHUNK];
+    }
+
+    /**
+     * @class Iter
+     * @brief Iterador que recorre las casillas ocupadas en orden de índice
+     */
+    template <typename M, typename V>
+    class Iter {
+        friend class SlotMap;
+
+     private:
+        M     *map_;
+        size_t i_;
+
+        Iter(M *map, size_t i) : map_(map), i_(i) {
+            skip();
+        }
+
+        void skip() {
+            while (i_ < map_->used_) {
+                if (!map_->chunks_[i_ / CHUNK]) {
+                    i_ = std::min((i_ / CHUNK + 1) * CHUNK, map_->used_);
+                } else if (!map_->slot(i_).alive) {
+                    ++i_;
+                } else {
+                    break;
+                }
+            }
+        }
+
+     public:
+        V& operator*() const {
+            return *map_->slot(i_).obj();
+        }
+
+        V *operator->() const {
+            return map_->slot(i_).obj();
+        }
+
+        Iter& operator++() {
+            ++i_;
+            skip();
+            return *this;
+        }
+
+        bool operator==(const Iter& o) const {
+            return i_ == o.i_;
+        }
+
+        bool operator!=(const Iter& o) const {
+            return i_ != o.i_;
+        }
+
+        /// @brief Handle del objeto al que apunta el iterador.
+        Handle handle() const {
+            return {uint32_t(i_), map_->slot(i_).generation};
+        }
+    };
+
+ public:
+    typedef Iter<SlotMap, T>             iterator;
+    typedef Iter<const SlotMap, const T> const_iterator;
+
+    SlotMap() {}
+
+    SlotMap(const SlotMap&) = delete;
+    SlotMap& operator=(const SlotMap&) = delete;
+
+    ~SlotMap() {
+        clear();
+    }
+
+    /**
+     * @brief Construye un objeto en el contenedor
+     * @param args Parámetros de la constructora de T
+     * \post El objeto está en el contenedor y se devuelve su handle (get(handle) es su dirección,
+     * que no cambia hasta que se borre)
+     */
+    template <typename... Args>
+    Handle emplace(Args&&...args) {
+        if (free_.empty() && !empty_.empty()) {
+            // Se vuelve a crear un bloque liberado por compact() antes de añadir otro
+            const size_t c = empty_.back();
+            empty_.pop_back();
+            make_chunk(c);
+            for (size_t i = std::min((c + 1) * CHUNK, used_); i > c * CHUNK; --i) {
+                free_.push_back(uint32_t(i - 1));
+            }
+        }
+        size_t i;
+        if (!free_.empty()) {
+            i = free_.back();
+            free_.pop_back();
+        } else {
+            if (used_ == chunks_.size() * CHUNK) {
+                chunks_.emplace_back();
+                live_.push_back(0);
+                make_chunk(chunks_.size() - 1);
+            }
+            i = used_++;
+        }
+        Slot& s = slot(i);
+        new (s.storage) T(std::forward<Args>(args)...);
+        s.alive = true;
+        live_[i / CHUNK]++;
+        size_++;
+        return {uint32_t(i), s.generation};
+    }
+
+    /**
+     * @brief Borra un objeto
+     * \post Si h es un handle vivo, el objeto se ha destruido y su casilla queda libre (los handles
+     * del objeto dejan de ser válidos). Devuelve si se ha borrado.
+     */
+    bool erase(Handle h) {
+        if (!contains(h)) {
+            return false;
+        }
+        Slot& s = slot(h.index);
+        s.obj()->~T();
+        s.alive = false;
+        s.generation++;
+        free_.push_back(h.index);
+        live_[h.index / CHUNK]--;
+        size_--;
+        return true;
+    }
+
+    /**
+     * @brief Libera los bloques sin ningún objeto vivo
+     *        Los objetos no se mueven, así que sus direcciones y sus handles siguen siendo válidos.
+     * \post Los bloques vacíos ya no ocupan memoria; devuelve el número de bytes liberados
+     */
+    size_t compact() {
+        std::vector<bool> drop(chunks_.size(), false);
+        size_t            freed = 0;
+        for (size_t c = 0; c < chunks_.size(); ++c) {
+            if (chunks_[c] && live_[c] == 0) {
+                for (size_t k = 0; k < CHUNK; ++k) {
+                    floor_ = std::max(floor_, chunks_[c][k].generation + 1);
+                }
+                chunks_[c].reset();
+                empty_.push_back(c);
+                drop[c] = true;
+                freed += CHUNK * sizeof(Slot);
+            }
+        }
+        if (freed > 0) {
+            size_t n = 0;
+            for (uint32_t i : free_) {
+                if (!drop[i / CHUNK]) {
+                    free_[n++] = i;
+                }
+            }
+            free_.resize(n);
+            free_.shrink_to_fit();
+        }
+        return freed;
+    }
+
+    /**
+     * @brief Comprueba un handle
+     * \post Devuelve true si h es el handle de un objeto del contenedor
+     */
+    bool contains(Handle h) const {
+        return h.index < used_ && chunks_[h.index / CHUNK] && slot(h.index).alive &&
+               slot(h.index).generation == h.generation;
+    }
+
+    /**
+     * @brief Objeto de un handle
+     * \post Devuelve la dirección del objeto de h, o nullptr si h no es válido
+     */
+    T *get(Handle h) {
+        return contains(h) ? slot(h.index).obj() : nullptr;
+    }
+
+    const T *get(Handle h) const {
+        return contains(h) ? slot(h.index).obj() : nullptr;
+    }
+
+    /// @brief Número de objetos.
+    size_t size() const {
+        return size_;
+    }
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    /**
+     * @brief Borra todos los objetos y libera los bloques
+     * \post El contenedor está vacío y no ocupa memoria; los handles anteriores ya no son válidos
+     * (las casillas nuevas empiezan con una generación mayor que todas las usadas, como en
+     * compact())
+     */
+    void clear() {
+        for (size_t i = 0; i < used_; ++i) {
+            if (chunks_[i / CHUNK]) {
+                Slot& s = slot(i);
+                if (s.alive) {
+                    s.obj()->~T();
+                }
+                floor_ = std::max(floor_, s.generation + 1);
+            }
+        }
+        chunks_.clear();
+        live_.clear();
+        empty_.clear();
+        free_.clear();
+        used_ = size_ = 0;
+    }
+
+    /**
+     * @brief Memoria reservada
+     * \post Devuelve el número de bytes de los bloques de casillas y de la lista de libres
+     */
+    size_t memory_bytes() const {
+        return (chunks_.size() - empty_.size()) * CHUNK * sizeof(Slot) +
+               free_.capacity() * sizeof(uint32_t);
+    }
+
+    iterator begin() {
+        return iterator(this, 0);
+    }
+
+    iterator end() {
+        return iterator(this, used_);
+    }
+
+    const_iterator begin() const {
+        return const_iterator(this, 0);
+    }
+
+    const_iterator end() const {
+        return const_iterator(this, used_);
+    }
+};
+
+#endif
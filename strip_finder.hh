@@ -0,0 +1,285 @@
+/** @file strip_finder.hh
+ *  @brief Especificación de la clase StripFinder
+ */
+
+#ifndef STRIP_FINDER_HH
+#define STRIP_FINDER_HH
+
+#include "flat_map.hh"
+#include "sweep.hh"
+#include "utils.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <vector>
+#endif
+
+/** @class StripFinder
+ *  @brief Índice estático para objetos repartidos a lo largo del eje x que no se mueven o que
+ *         solo se mueven dentro de una zona conocida (como las plataformas del nivel).
+ *
+ *  Guarda un vector de intervalos ordenado por su extremo izquierdo junto con el máximo de los
+ *  extremos derechos de cada prefijo, de forma que una consulta encuentra con dos búsquedas
+ *  binarias el tramo de intervalos candidatos y lo recorre de forma lineal: O(log n + k).
+ *
+ *  Para cada objeto se guarda su zona de movimiento (get_move_bounds() si el tipo la tiene, y si
+ *  no get_rect()). Mientras el objeto no sale de esa zona no hay que reindexarlo; la posición
+ *  exacta solo se consulta para los candidatos de cada consulta. Los objetos añadidos después de
+ *  build() o que salen de su zona pasan a una pequeña lista dinámica que se recorre entera y que
+ *  se vuelve a fusionar con el vector ordenado cuando crece demasiado.
+ *
+ *  Ofrece la misma interfaz que Finder (add/update/update_many/remove/for_each/query/sweep/
+ *  segment).
+ *
+ *  @tparam T Tipo de objeto (debe tener método get_rect())
+ */
+template <typename T>
+class StripFinder {
+ public:
+    /// @brief Resultado de sweep() y segment().
+    typedef SweepHit<T> Hit;
+
+ private:
+    /**
+     * @class Entry
+     * @brief Objeto del vector ordenado junto con su zona de movimiento
+     */
+    struct Entry {
+        pro2::Rect bounds;
+        T         *obj;  ///< nullptr si el objeto se ha eliminado o ha pasado a overlay_
+    };
+
+    /// @brief Intervalos ordenados por bounds.left.
+    std::vector<Entry> entries_;
+
+    /// @brief max_right_[i] es el máximo de bounds.right de entries_[0..i].
+    std::vector<int> max_right_;
+
+    /// @brief Objetos fuera del vector ordenado (se recorren enteros en cada consulta).
+    std::vector<T *> overlay_;
+
+    /// @brief Posición de cada objeto: i >= 0 en entries_, -1 - i en overlay_.
+    FlatMap<T *, int> index_;
+
+    /// @brief Entradas vacías de entries_ (eliminadas o pasadas a overlay_).
+    int dead_ = 0;
+
+    /// @brief Vector auxiliar reutilizado por query() para ordenar los resultados.
+    std::vector<std::pair<pro2::Rect, T *>> scratch_;
+
+    /**
+     * @brief Pasa un objeto del vector ordenado a la lista dinámica
+     * \pre t está en entries_[i]
+     * \post t está en overlay_ y entries_[i] queda vacía
+     */
+    void to_overlay(T *t, int i) {
+        entries_[i].obj = nullptr;
+        dead_++;
+        index_[t] = -1 - int(overlay_.size());
+        overlay_.push_back(t);
+        if (overlay_.size() > 32 && overlay_.size() * 16 > entries_.size()) {
+            rebuild();
+        }
+    }
+
+    /**
+     * @brief Vuelve a construir el vector ordenado con todos los objetos actuales
+     * \post overlay_ está vacío y entries_ contiene todos los objetos con su zona actual
+     */
+    void rebuild() {
+        std::vector<T *> objs;
+        objs.reserve(index_.size());
+        for (const Entry& e : entries_) {
+            if (e.obj != nullptr) {
+                objs.push_back(e.obj);
+            }
+        }
+        objs.insert(objs.end(), overlay_.begin(), overlay_.end());
+        build(objs);
+    }
+
+ public:
+    /// @brief Constructora de StripFinder.
+    StripFinder() {}
+
+    /**
+     * @brief Construye el índice de golpe a partir de todos los objetos
+     * @param objs Rango con size() (por ejemplo un std::vector) de punteros a los objetos a indexar
+     * \pre Cada objeto tiene método get_rect()
+     * \post El índice contiene exactamente los objetos de objs (se descarta el contenido previo)
+     */
+    template <typename Range>
+    void build(const Range& objs) {
+        entries_.clear();
+        overlay_.clear();
+        index_.clear();
+        dead_ = 0;
+        entries_.reserve(objs.size());
+        for (T *t : objs) {
+            pro2::Rect bounds = motion_bounds(*t);
+            pro2::Rect rect = t->get_rect();
+            bounds = {std::min(bounds.left, rect.left), std::min(bounds.top, rect.top),
+                      std::max(bounds.right, rect.right), std::max(bounds.bottom, rect.bottom)};
+            entries_.push_back({bounds, t});
+        }
+        auto by_left = [](const Entry& a, const Entry& b) {
+            return a.bounds.left != b.bounds.left ? a.bounds.left < b.bounds.left
+                                                  : a.bounds.top < b.bounds.top;
+        };
+        // Las plataformas se generan de izquierda a derecha: normalmente ya están ordenadas
+        if (!std::is_sorted(entries_.begin(), entries_.end(), by_left)) {
+            std::sort(entries_.begin(), entries_.end(), by_left);
+        }
+        max_right_.resize(entries_.size());
+        index_.reserve(entries_.size());
+        for (size_t i = 0; i < entries_.size(); ++i) {
+            max_right_[i] = i == 0 ? entries_[i].bounds.right
+                                   : std::max(max_right_[i - 1], entries_[i].bounds.right);
+            index_[entries_[i].obj] = int(i);
+        }
+    }
+
+    /**
+     * @brief Añade un objeto después de build()
+     * @param t Puntero al objeto a añadir
+     * \pre t no está en el índice
+     * \post t está en la lista dinámica
+     */
+    void add(T *t) {
+        index_[t] = -1 - int(overlay_.size());
+        overlay_.push_back(t);
+    }
+
+    /**
+     * @brief Actualiza un objeto que se ha movido
+     *        Si el objeto sigue dentro de la zona con la que se indexó no hay que hacer nada;
+     *        si ha salido, pasa a la lista dinámica.
+     * @param t Puntero al objeto a actualizar
+     * \post Devuelve true si el objeto ha tenido que cambiar de sitio en el índice
+     */
+    bool update(T *t) {
+        int *pos = index_.find(t);
+        if (pos == nullptr || *pos < 0) {
+            return false;
+        }
+        const pro2::Rect& bounds = entries_[*pos].bounds;
+        pro2::Rect        rect = t->get_rect();
+        if (bounds.left <= rect.left && rect.right <= bounds.right && bounds.top <= rect.top &&
+            rect.bottom <= bounds.bottom) {
+            return false;
+        }
+        to_overlay(t, *pos);
+        return true;
+    }
+
+    /**
+     * @brief Actualiza de golpe un conjunto de objetos
+     * @param objs Rango de punteros a objetos del índice
+     * \post Todos los objetos de objs están actualizados
+     */
+    template <typename Range>
+    void update_many(const Range& objs) {
+        for (T *t : objs) {
+            update(t);
+        }
+    }
+
+    /**
+     * @brief Elimina un objeto del índice
+     * @param t Puntero al objeto a eliminar
+     * \post t ya no aparece en las consultas
+     */
+    void remove(T *t) {
+        int *pos = index_.find(t);
+        if (pos == nullptr) {
+            return;
+        }
+        int i = *pos;
+        index_.erase(t);
+        if (i >= 0) {
+            entries_[i].obj = nullptr;
+            dead_++;
+            if (dead_ > 32 && size_t(2 * dead_) > entries_.size()) {
+                rebuild();
+            }
+        } else {
+            i = -1 - i;
+            overlay_[i] = overlay_.back();
+            overlay_.pop_back();
+            if (size_t(i) < overlay_.size()) {
+                index_[overlay_[i]] = -1 - i;
+            }
+        }
+    }
+
+    /**
+     * @brief Visita los objetos con rectángulo total o parcial dentro de 'rect'.
+     *        Busca de forma binaria el último intervalo que empieza antes de rect.right y el
+     *        primero cuyo prefijo puede llegar a rect.left, recorre ese tramo comprobando la
+     *        posición exacta de cada candidato y después recorre la lista dinámica.
+     * @param rect El rectángulo de búsqueda
+     * @param visit Función llamada como visit(T *obj, const pro2::Rect& obj_rect)
+     * \post Se ha llamado a visit una vez por objeto; los del vector ordenado, por x creciente
+     */
+    template <typename F>
+    void for_each(const pro2::Rect& rect, F&& visit) const {
+        auto end = std::upper_bound(
+            entries_.begin(), entries_.end(), rect.right,
+            [](int x, const Entry& e) { return x < e.bounds.left; });
+        auto first = std::lower_bound(max_right_.begin(), max_right_.end(), rect.left);
+        for (auto it = entries_.begin() + (first - max_right_.begin()); it < end; ++it) {
+            if (it->obj != nullptr && intesec_rect(rect, it->bounds)) {
+                pro2::Rect r = it->obj->get_rect();
+                if (intesec_rect(rect, r)) {
+                    visit(it->obj, r);
+                }
+            }
+        }
+        for (T *t : overlay_) {
+            pro2::Rect r = t->get_rect();
+            if (intesec_rect(rect, r)) {
+                visit(t, r);
+            }
+        }
+    }
+
+    /**
+     * @brief Barrido de un rectángulo en movimiento, como en Finder::sweep
+     * \post out contiene los objetos que toca box al desplazarse delta, ordenados por el instante
+     * del primer contacto
+     */
+    void sweep(const pro2::Rect& box, pro2::Pt delta, std::vector<Hit>& out) const {
+        sweep_index(*this, box, delta, out);
+    }
+
+    /**
+     * @brief Objetos que toca el segmento de 'from' a 'to', como en Finder::segment
+     * \post out contiene los objetos que toca el segmento ordenados por el instante del primer
+     * contacto
+     */
+    void segment(pro2::Pt from, pro2::Pt to, std::vector<Hit>& out) const {
+        sweep({from.x, from.y, from.x, from.y}, {to.x - from.x, to.y - from.y}, out);
+    }
+
+    /**
+     * @brief Escribe en 'out' los objetos con rectángulo total o parcial dentro de 'rect'.
+     * @param rect El rectángulo de búsqueda
+     * @param out Vector donde se dejan los resultados (se vacía antes)
+     * \post out contiene los objetos que intersectan con 'rect' ordenados por la esquina superior
+     * izquierda de su rectángulo, como en Finder::query
+     */
+    void query(const pro2::Rect& rect, std::vector<T *>& out) {
+        scratch_.clear();
+        for_each(rect, [this](T *t, const pro2::Rect& r) { scratch_.push_back({r, t}); });
+        std::sort(scratch_.begin(), scratch_.end(), [](const auto& a, const auto& b) {
+            return a.first.left != b.first.left ? a.first.left < b.first.left
+                                                : a.first.top < b.first.top;
+        });
+        out.clear();
+        for (const auto& hit : scratch_) {
+            out.push_back(hit.second);
+        }
+    }
+};
+
+#endif
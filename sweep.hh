@@ -0,0 +1,132 @@
+/** @file sweep.hh
+ *  @brief Consultas de barrido (segmentos y rectángulos en movimiento) para la colisión continua
+ */
+
+#ifndef SWEEP_HH
+#define SWEEP_HH
+
+#include "geometry.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <vector>
+#endif
+
+/**
+ * @class SweepHit
+ * @brief Objeto tocado por un barrido, con el instante y la cara del primer contacto
+ * @tparam T Tipo de objeto
+ */
+template <typename T>
+struct SweepHit {
+    T         *obj;     ///< Objeto tocado
+    pro2::Rect rect;    ///< Rectángulo del objeto
+    float      t;       ///< Instante del primer contacto en [0, 1] (0 si ya se solapaban)
+    pro2::Pt   normal;  ///< Cara tocada del objeto: {0, -1} la de arriba, {-1, 0} la izquierda...
+                        ///< ({0, 0} si ya se solapaban al empezar)
+};
+
+/**
+ * @brief Rectángulo que cubre todo el recorrido de un rectángulo en movimiento
+ * @param box Rectángulo al empezar el movimiento
+ * @param delta Desplazamiento
+ * \post Devuelve la unión de box y de box desplazado delta
+ */
+inline pro2::Rect swept_bounds(const pro2::Rect& box, pro2::Pt delta) {
+    return {box.left + std::min(delta.x, 0), box.top + std::min(delta.y, 0),
+            box.right + std::max(delta.x, 0), box.bottom + std::max(delta.y, 0)};
+}
+
+/**
+ * @brief Intervalo de tiempo en el que dos rectángulos se solapan sobre un eje
+ *        Los rectángulos ocupan [lo, hi] y [target_lo, target_hi] (con los extremos incluidos,
+ *        como en intesec_rect) y el primero se desplaza d a lo largo del movimiento.
+ * \post Devuelve false si nunca se solapan; si no, [enter, exit] es el intervalo de solape
+ */
+inline bool sweep_axis(int lo, int hi, int d, int target_lo, int target_hi, float& enter,
+                       float& exit) {
+    if (d == 0) {
+        enter = -1e30f;
+        exit = 1e30f;
+        return lo <= target_hi && hi >= target_lo;
+    }
+    const float inv = 1.0f / float(d);
+    const float t0 = float(target_lo - hi) * inv;
+    const float t1 = float(target_hi - lo) * inv;
+    enter = std::min(t0, t1);
+    exit = std::max(t0, t1);
+    return true;
+}
+
+/**
+ * @brief Prueba de barrido de un rectángulo contra otro (separación por ejes)
+ *        Calcula en cada eje el intervalo de tiempo en el que los rectángulos se solapan; hay
+ *        contacto si los dos intervalos se cortan dentro de [0, 1]. Un segmento es un barrido de
+ *        un rectángulo de un solo punto.
+ * @param box Rectángulo al empezar el movimiento
+ * @param delta Desplazamiento de box
+ * @param target Rectángulo quieto
+ * @param t Instante del primer contacto
+ * @param normal Cara de target por la que entra box
+ * \post Devuelve true si box toca target en algún momento del movimiento; en ese caso t y normal
+ * describen el primer contacto (t = 0 y normal = {0, 0} si ya se solapaban)
+ */
+inline bool sweep_rect(const pro2::Rect& box, pro2::Pt delta, const pro2::Rect& target, float& t,
+                       pro2::Pt& normal) {
+    float x_enter, x_exit, y_enter, y_exit;
+    if (!sweep_axis(box.left, box.right, delta.x, target.left, target.right, x_enter, x_exit) ||
+        !sweep_axis(box.top, box.bottom, delta.y, target.top, target.bottom, y_enter, y_exit)) {
+        return false;
+    }
+    const float enter = std::max(x_enter, y_enter);
+    const float exit = std::min(x_exit, y_exit);
+    if (enter > exit || enter > 1.0f || exit < 0.0f) {
+        return false;
+    }
+    if (enter <= 0.0f) {
+        t = 0.0f;
+        normal = {0, 0};
+    } else if (x_enter > y_enter) {
+        t = enter;
+        normal = {delta.x > 0 ? -1 : 1, 0};
+    } else {
+        t = enter;
+        normal = {0, delta.y > 0 ? -1 : 1};
+    }
+    return true;
+}
+
+/**
+ * @brief Barrido de un rectángulo contra los objetos de un índice
+ *        La fase amplia es una consulta del índice con swept_bounds, así que solo se comprueban
+ *        los objetos cercanos al recorrido y no todos los visibles; cada candidato pasa después
+ *        por sweep_rect. Lo usan Finder::sweep y StripFinder::sweep.
+ * @param index Índice con for_each(rect, visit(T *obj, const pro2::Rect& obj_rect))
+ * @param box Rectángulo al empezar el movimiento
+ * @param delta Desplazamiento de box
+ * @param out Vector donde se dejan los resultados (se vacía antes)
+ * \post out contiene los objetos que toca box a lo largo del movimiento, ordenados por instante
+ * del primer contacto y, a igualdad, por la esquina superior izquierda de su rectángulo
+ */
+template <typename Index, typename T>
+void sweep_index(const Index& index, const pro2::Rect& box, pro2::Pt delta,
+                 std::vector<SweepHit<T>>& out) {
+    out.clear();
+    index.for_each(swept_bounds(box, delta), [&](T *obj, const pro2::Rect& r) {
+        SweepHit<T> hit = {obj, r, 0.0f, {0, 0}};
+        if (sweep_rect(box, delta, r, hit.t, hit.normal)) {
+            out.push_back(hit);
+        }
+    });
+    std::sort(out.begin(), out.end(), [](const SweepHit<T>& a, const SweepHit<T>& b) {
+        if (a.t != b.t) {
+            return a.t < b.t;
+        }
+        if (a.rect.left != b.rect.left) {
+            return a.rect.left < b.rect.left;
+        }
+        return a.rect.top < b.rect.top;
+    });
+}
+
+#endif
@@ -6,6 +6,10 @@
 #define UTILS_HH
 
 #ifndef NO_DIAGRAM
+#include <algorithm>
+#include <cstdint>
+#include <type_traits>
+#include <utility>
 #include <vector>
 #endif
 
@@ -75,6 +79,46 @@ void paint_rect(pro2::Window& window, pro2::Rect& rect, pro2::Color color);
  * \pre Ambos rectángulos deben estar inicializados
  * \post Devuelve true si hay intersección, false en caso contrario
  */
-bool intesec_rect(pro2::Rect& rect1, pro2::Rect& rect2);
+bool intesec_rect(const pro2::Rect& rect1, const pro2::Rect& rect2);
+
+/**
+ * @brief Punto de un rectángulo más cercano a un punto
+ * @param pt Punto
+ * @param rect Rectángulo
+ * \post Devuelve pt si está dentro de rect y, si no, el punto del borde de rect más cercano
+ */
+pro2::Pt closest_pt(pro2::Pt pt, const pro2::Rect& rect);
+
+/**
+ * @brief Distancia al cuadrado entre un punto y un rectángulo
+ * @param pt Punto
+ * @param rect Rectángulo
+ * \post Devuelve el cuadrado de la distancia de pt a closest_pt(pt, rect) (0 si está dentro)
+ */
+int64_t dist2_pt_rect(pro2::Pt pt, const pro2::Rect& rect);
+
+/**
+ * @brief Indica si un tipo tiene método get_move_bounds() (zona que puede llegar a ocupar un
+ *        objeto con movimiento acotado, como las plataformas o los aliens)
+ */
+template <typename U, typename = void>
+struct has_move_bounds : std::false_type {};
+
+template <typename U>
+struct has_move_bounds<U, std::void_t<decltype(std::declval<const U&>().get_move_bounds())>>
+    : std::true_type {};
+
+/**
+ * @brief Zona que puede llegar a ocupar un objeto
+ * \post Devuelve u.get_move_bounds() si el tipo lo tiene y, si no, el rectángulo actual de u
+ */
+template <typename U>
+pro2::Rect motion_bounds(const U& u) {
+    if constexpr (has_move_bounds<U>::value) {
+        return u.get_move_bounds();
+    } else {
+        return u.get_rect();
+    }
+}
 
 #endif
\ No newline at end of file
@@ -0,0 +1,340 @@
+/** @file visible_set.hh
+ *  @brief Especificación de la clase VisibleSet
+ */
+
+#ifndef VISIBLE_SET_HH
+#define VISIBLE_SET_HH
+
+#include "flat_map.hh"
+#include "utils.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#include <type_traits>
+#include <vector>
+#endif
+
+/**
+ * @class ExactRect
+ * @brief Regla de visibilidad por defecto de VisibleSet: un objeto es visible si su rectángulo
+ *        actual (get_rect()) intersecta con la cámara
+ */
+struct ExactRect {
+    template <typename T>
+    static pro2::Rect of(const T& t) {
+        return t.get_rect();
+    }
+};
+
+/**
+ * @class MotionRect
+ * @brief Regla de visibilidad por la zona de movimiento: un objeto es visible si su zona de
+ *        movimiento (que incluye su rectángulo actual) intersecta con la cámara
+ *        Es el rectángulo con el que LayeredFinder guarda los objetos. Sirve para los objetos
+ *        cuya posición se calcula al pedirla (como los aliens): se mueven sin avisar a nadie, pero
+ *        nunca salen de su zona.
+ */
+struct MotionRect {
+    template <typename T>
+    static pro2::Rect of(const T& t) {
+        const pro2::Rect rect = t.get_rect();
+        const pro2::Rect b = motion_bounds(t);
+        return {std::min(b.left, rect.left), std::min(b.top, rect.top),
+                std::max(b.right, rect.right), std::max(b.bottom, rect.bottom)};
+    }
+};
+
+/**
+ * @class CameraStrips
+ * @brief Zonas que hay que consultar en un refresh() de VisibleSet
+ */
+struct CameraStrips {
+    pro2::Rect enter[4];     ///< Zonas donde buscar objetos que entran
+    int        n_enter = 0;  ///< Número de zonas en enter
+    pro2::Rect leave[4];     ///< Zonas donde buscar objetos que salen
+    int        n_leave = 0;  ///< Número de zonas en leave
+};
+
+/**
+ * @brief Compara las zonas de dos refresh()
+ * \post Devuelve true si a y b tienen las mismas zonas en el mismo orden
+ */
+inline bool same_strips(const CameraStrips& a, const CameraStrips& b) {
+    if (a.n_enter != b.n_enter || a.n_leave != b.n_leave) {
+        return false;
+    }
+    for (int i = 0; i < a.n_enter; ++i) {
+        if (a.enter[i] != b.enter[i]) {
+            return false;
+        }
+    }
+    for (int i = 0; i < a.n_leave; ++i) {
+        if (a.leave[i] != b.leave[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/** @class VisibleSet
+ *  @brief Conjunto persistente de los objetos que intersectan con la cámara.
+ *
+ *  En lugar de volver a consultar el índice con todo el rectángulo de la cámara en cada
+ *  fotograma, refresh() solo consulta las franjas que la cámara ha descubierto (para encontrar
+ *  los objetos que entran) y las que ha dejado de ver (para encontrar los que salen). Como la
+ *  cámara se desplaza unos pocos píxeles por fotograma, el coste depende del movimiento de la
+ *  cámara y no de cuántos objetos hay en pantalla.
+ *
+ *  Un objeto es visible si el rectángulo que le da la regla Rule intersecta con la cámara, y
+ *  todos los pasos de refresh() usan esa misma regla. Con ExactRect (por defecto) es su
+ *  rectángulo actual, el mismo que pasan los índices a for_each aunque guarden una zona mayor (la
+ *  de movimiento), y los objetos que se mueven por sí mismos, aunque no salgan de su zona en el
+ *  índice, se comunican con touch() y se vuelven a comprobar en el siguiente refresh(). Con
+ *  MotionRect es su zona de movimiento, que solo conoce LayeredFinder::refresh_visible(). Cada
+ *  refresh() deja en entered() y left() los objetos que han entrado y salido de la cámara.
+ *
+ *  refresh() también se puede hacer por pasos (begin_refresh(), found_entering() y
+ *  found_leaving() con los objetos de las zonas, y end_refresh()), de forma que un índice con
+ *  varios tipos de objeto (LayeredFinder::refresh_visible) rellene varios conjuntos con un único
+ *  recorrido.
+ *
+ *  @tparam T Tipo de objeto (debe tener método get_rect())
+ *  @tparam Rule Regla de visibilidad (ExactRect o MotionRect)
+ */
+template <typename T, typename Rule = ExactRect>
+class VisibleSet {
+ private:
+    /// @brief Objetos visibles. El orden solo depende de la secuencia de entradas y salidas.
+    std::vector<T *> items_;
+
+    /// @brief Posición de cada objeto visible dentro de items_.
+    FlatMap<T *, int> pos_;
+
+    /// @brief Objetos que se han movido desde el último refresh().
+    std::vector<T *> pending_;
+
+    /// @brief Eventos del último refresh().
+    std::vector<T *> entered_, left_;
+
+    /// @brief Rectángulo de la cámara en el último refresh().
+    pro2::Rect camera_;
+
+    /// @brief Si ya se ha hecho algún refresh().
+    bool valid_ = false;
+
+    /**
+     * @brief Añade un objeto al conjunto si no estaba
+     * \post t está en items_ y, si no estaba, en entered_
+     */
+    void enter(T *t) {
+        if (pos_.find(t) == nullptr) {
+            pos_[t] = int(items_.size());
+            items_.push_back(t);
+            entered_.push_back(t);
+        }
+    }
+
+    /**
+     * @brief Quita un objeto del conjunto si estaba (intercambiándolo con el último)
+     * \post t no está en items_; devuelve si estaba
+     */
+    bool leave(T *t) {
+        int *pos = pos_.find(t);
+        if (pos == nullptr) {
+            return false;
+        }
+        int i = *pos;
+        pos_.erase(t);
+        items_[i] = items_.back();
+        items_.pop_back();
+        if (size_t(i) < items_.size()) {
+            pos_[items_[i]] = i;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Calcula las franjas de 'a' que no están en 'b'
+     * @param out Vector donde se dejan hasta 4 rectángulos disjuntos que cubren a - b
+     * @param n Número de rectángulos escritos en out
+     * \pre a y b se intersectan
+     */
+    static void difference(const pro2::Rect& a, const pro2::Rect& b, pro2::Rect out[4], int& n) {
+        n = 0;
+        if (a.left < b.left) {
+            out[n++] = {a.left, a.top, b.left - 1, a.bottom};
+        }
+        if (a.right > b.right) {
+            out[n++] = {b.right + 1, a.top, a.right, a.bottom};
+        }
+        const int left = std::max(a.left, b.left);
+        const int right = std::min(a.right, b.right);
+        if (a.top < b.top) {
+            out[n++] = {left, a.top, right, b.top - 1};
+        }
+        if (a.bottom > b.bottom) {
+            out[n++] = {left, b.bottom + 1, right, a.bottom};
+        }
+    }
+
+ public:
+    /// @brief Constructora de un conjunto vacío.
+    VisibleSet() {}
+
+    /**
+     * @brief Actualiza el conjunto para un nuevo rectángulo de cámara
+     *        Si la cámara ha saltado más lejos de lo que mide, o es la primera vez, se hace una
+     *        consulta completa. En otro caso solo se consultan las franjas descubiertas y
+     *        ocultadas, y se vuelven a comprobar los objetos pasados a touch().
+     * @param index Índice (Finder, StripFinder...) con método for_each(rect, visit)
+     * @param camera Rectángulo de la cámara
+     * \post El conjunto contiene los objetos de index que intersectan con camera; entered() y
+     * left() contienen los cambios respecto al refresh() anterior
+     */
+    template <typename Index>
+    void refresh(const Index& index, const pro2::Rect& camera) {
+        static_assert(std::is_same<Rule, ExactRect>::value,
+                      "Los índices pasan el rectángulo exacto: con MotionRect hay que usar "
+                      "LayeredFinder::refresh_visible()");
+        CameraStrips strips;
+        begin_refresh(camera, strips);
+        for (int i = 0; i < strips.n_enter; ++i) {
+            index.for_each(strips.enter[i], [this](T *t, const pro2::Rect&) { enter(t); });
+        }
+        for (int i = 0; i < strips.n_leave; ++i) {
+            index.for_each(strips.leave[i],
+                           [this](T *t, const pro2::Rect& r) { found_leaving(t, r); });
+        }
+        end_refresh();
+    }
+
+    /**
+     * @brief Primer paso de refresh(): calcula las zonas que hay que consultar
+     * @param camera Rectángulo de la cámara
+     * @param strips Zonas donde buscar los objetos que entran y los que salen
+     * \post Los objetos visibles que ya no tocan la cámara tras un salto se han quitado; hay que
+     * pasar los objetos de strips.enter a found_entering() y los de strips.leave a
+     * found_leaving(), y acabar con end_refresh()
+     */
+    void begin_refresh(const pro2::Rect& camera, CameraStrips& strips) {
+        entered_.clear();
+        left_.clear();
+        if (!valid_ || !intesec_rect(camera, camera_)) {
+            for (size_t i = 0; i < items_.size();) {
+                T *t = items_[i];
+                if (!intesec_rect(camera, Rule::of(*t)) && leave(t)) {
+                    left_.push_back(t);
+                } else {
+                    ++i;
+                }
+            }
+            strips.enter[0] = camera;
+            strips.n_enter = 1;
+            strips.n_leave = 0;
+            valid_ = true;
+        } else {
+            difference(camera, camera_, strips.enter, strips.n_enter);
+            difference(camera_, camera, strips.leave, strips.n_leave);
+        }
+        camera_ = camera;
+    }
+
+    /**
+     * @brief Objeto encontrado en una zona strips.enter
+     * \pre El rectángulo de t según Rule intersecta con la zona
+     * \post t está en el conjunto
+     */
+    void found_entering(T *t) {
+        enter(t);
+    }
+
+    /**
+     * @brief Objeto encontrado en una zona strips.leave
+     * @param r Rectángulo del objeto según Rule
+     * \post Si r ya no toca la cámara, t no está en el conjunto
+     */
+    void found_leaving(T *t, const pro2::Rect& r) {
+        if (!intesec_rect(camera_, r) && leave(t)) {
+            left_.push_back(t);
+        }
+    }
+
+    /**
+     * @brief Último paso de refresh(): vuelve a comprobar los objetos pasados a touch()
+     * \post El conjunto contiene los objetos que intersectan con la cámara
+     */
+    void end_refresh() {
+        for (T *t : pending_) {
+            if (intesec_rect(camera_, Rule::of(*t))) {
+                enter(t);
+            } else if (leave(t)) {
+                left_.push_back(t);
+            }
+        }
+        pending_.clear();
+    }
+
+    /**
+     * @brief Indica que un objeto se ha movido
+     * @param t Objeto que se ha movido (esté o no en el conjunto)
+     * \post t se volverá a comprobar contra la cámara en el siguiente refresh()
+     */
+    void touch(T *t) {
+        pending_.push_back(t);
+    }
+
+    /**
+     * @brief Indica que varios objetos se han movido (por ejemplo Finder::moved())
+     * @param objs Rango de objetos que se han movido
+     */
+    template <typename Range>
+    void touch_all(const Range& objs) {
+        pending_.insert(pending_.end(), objs.begin(), objs.end());
+    }
+
+    /**
+     * @brief Quita un objeto que ha dejado de existir o se ha quitado del índice
+     * @param t Objeto a quitar
+     * \post t no está en el conjunto ni pendiente de comprobar. El último objeto del conjunto
+     * pasa a ocupar su posición.
+     */
+    void erase(T *t) {
+        leave(t);
+        pending_.erase(std::remove(pending_.begin(), pending_.end(), t), pending_.end());
+    }
+
+    /// @brief Objetos visibles.
+    const std::vector<T *>& items() const {
+        return items_;
+    }
+
+    /// @brief Número de objetos visibles.
+    size_t size() const {
+        return items_.size();
+    }
+
+    /// @brief Objeto visible i-ésimo. \pre 0 <= i < size()
+    T *operator[](size_t i) const {
+        return items_[i];
+    }
+
+    typename std::vector<T *>::const_iterator begin() const {
+        return items_.begin();
+    }
+
+    typename std::vector<T *>::const_iterator end() const {
+        return items_.end();
+    }
+
+    /// @brief Objetos que entraron en la cámara en el último refresh().
+    const std::vector<T *>& entered() const {
+        return entered_;
+    }
+
+    /// @brief Objetos que salieron de la cámara en el último refresh().
+    const std::vector<T *>& left() const {
+        return left_;
+    }
+};
+
+#endif
@@ -7,6 +7,11 @@
 // </HUGE-WARNING>
 
 #include "window.hh"
+
+#ifndef NO_DIAGRAM
+#include <algorithm>
+#endif
+
 using std::string;
 
 namespace pro2 {
@@ -14,9 +19,12 @@ namespace pro2 {
 Window::Window(string title, int width, int height, int zoom)
     : fenster_{.title = title.c_str(), .width = width * zoom, .height = height * zoom},
       zoom_(zoom),
-      pixels_size_(width * height * zoom * zoom)  //
+      pixels_size_(width * height * zoom * zoom),
+      back_size_(width * height)  //
 {
-    pixels_ = new uint32_t[width * height * zoom * zoom];
+    pixels_ = alloc_pixels(pixels_size_);
+    back_ = alloc_pixels(back_size_);
+    fill_pixels(back_, back_size_, black);
     fenster_.buf = pixels_;
     fenster_open(&fenster_);
     last_time_ = fenster_time();
@@ -37,6 +45,10 @@ void Window::update_camera_() {
 }
 
 bool Window::next_frame() {
+    // Amplía el buffer de pintado al de la ventana antes de esperar, para que cuente como
+    // tiempo del fotograma
+    upscale_pixels(back_, width(), height(), pixels_, zoom_);
+
     update_camera_();
     int wait = int(1000.0 / fps_) - (fenster_time() - last_time_);
     if (wait > 0) {
@@ -55,8 +67,74 @@ bool Window::next_frame() {
 }
 
 void Window::clear(Color color) {
-    for (size_t i = 0; i < pixels_size_; i++) {
-        pixels_[i] = color;
+    fill_pixels(back_, back_size_, color);
+}
+
+bool Window::clip(Rect& rect) const {
+    rect.left = std::max(rect.left, topleft_.x);
+    rect.top = std::max(rect.top, topleft_.y);
+    rect.right = std::min(rect.right, topleft_.x + width() - 1);
+    rect.bottom = std::min(rect.bottom, topleft_.y + height() - 1);
+    return rect.left <= rect.right && rect.top <= rect.bottom;
+}
+
+void Window::put_span_(int y, int left, int right, const int *colors, int x0, int n,
+                       bool mirror) {
+    // Píxel del buffer en la columna left
+    uint32_t *dst = back_ + (y - topleft_.y) * width() + (left - topleft_.x);
+    auto      color_at = [=](int x) { return mirror ? colors[n - 1 - (x - x0)] : colors[x - x0]; };
+    int       x = left;
+    while (x <= right) {
+        while (x <= right && color_at(x) < 0) {
+            x++;
+        }
+        const int start = x;
+        while (x <= right && color_at(x) >= 0) {
+            x++;
+        }
+        if (mirror) {
+            std::reverse_copy(colors + n - (x - x0), colors + n - (start - x0),
+                              dst + (start - left));
+        } else {
+            std::copy(colors + (start - x0), colors + (x - x0), dst + (start - left));
+        }
+    }
+}
+
+void Window::blit_span(Pt xy, const int *colors, int n, bool mirror) {
+    Rect rect = {xy.x, xy.y, xy.x + n - 1, xy.y};
+    if (n > 0 && clip(rect)) {
+        put_span_(xy.y, rect.left, rect.right, colors, xy.x, n, mirror);
+    }
+}
+
+void Window::blit_rect(Pt orig, const std::vector<std::vector<int>>& rows, bool mirror) {
+    int width = 0;
+    for (const std::vector<int>& row : rows) {
+        width = std::max(width, int(row.size()));
+    }
+    Rect rect = {orig.x, orig.y, orig.x + width - 1, orig.y + int(rows.size()) - 1};
+    if (!clip(rect)) {
+        return;
+    }
+    for (int y = rect.top; y <= rect.bottom; y++) {
+        const std::vector<int>& row = rows[y - orig.y];
+        const int               n = row.size();
+        const int               right = std::min(rect.right, orig.x + n - 1);
+        if (rect.left <= right) {
+            put_span_(y, rect.left, right, row.data(), orig.x, n, mirror);
+        }
+    }
+}
+
+void Window::fill_rect(Rect rect, Color color) {
+    if (!clip(rect)) {
+        return;
+    }
+    const int w = width();
+    for (int y = rect.top; y <= rect.bottom; y++) {
+        uint32_t *row = back_ + (y - topleft_.y) * w + (rect.left - topleft_.x);
+        std::fill(row, row + (rect.right - rect.left + 1), color);
     }
 }
 
@@ -80,17 +158,4 @@ Pt Window::mouse_pos() const {
     return Pt{x + topleft_.x, y + topleft_.y};
 }
 
-void Window::set_pixel(Pt pt, Color color) {
-    const Pt camera_pt = {pt.x - topleft_.x, pt.y - topleft_.y};
-    for (int i = 0; i < zoom_; i++) {
-        for (int j = 0; j < zoom_; j++) {
-            const int _i = camera_pt.x * zoom_ + i;
-            const int _j = camera_pt.y * zoom_ + j;
-            if (_i >= 0 && _i < fenster_.width && _j >= 0 && _j < fenster_.height) {
-                fenster_pixel(&fenster_, _i, _j) = color;
-            }
-        }
-    }
-}
-
 }  // namespace pro2
\ No newline at end of file
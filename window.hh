@@ -8,11 +8,13 @@
 #ifndef NO_DIAGRAM
 #include <cassert>
 #include <string>
+#include <vector>
 #endif
 
 #define FENSTER_HEADER
 #include "fenster.h"
 #include "geometry.hh"
+#include "pixel_buffer.hh"
 
 namespace pro2 {
 
@@ -82,18 +84,31 @@ class Window {
     fenster fenster_;
 
     /**
-     * @brief El buffer de pixels que se reserva como zona de pintado
+     * @brief El buffer de pixels que Fenster muestra en la ventana (con el zoom aplicado)
      *
      * Cada pixel tiene 32bits, o 4 bytes, y los 3 bytes de menos peso son los valores (entre 0 y
-     * 255) de los canales R, G y B (red, green y blue).
+     * 255) de los canales R, G y B (red, green y blue). Se reserva con `alloc_pixels`, alineado a
+     * 64 bytes.
      */
     uint32_t *pixels_;
 
     /**
-     * @brief Tamaño del buffer en bytes
+     * @brief Tamaño del buffer en píxeles
      */
     size_t pixels_size_;
 
+    /**
+     * @brief El buffer de pintado, de `width()` x `height()` píxeles (sin zoom)
+     *
+     * `set_pixel` y `clear` pintan aquí, y `next_frame` lo amplía una sola vez a `pixels_`.
+     */
+    uint32_t *back_;
+
+    /**
+     * @brief Tamaño del buffer de pintado en píxeles
+     */
+    size_t back_size_;
+
     /**
      * @brief Parámetro de `zoom` para esta ventana
      */
@@ -140,6 +155,16 @@ class Window {
      */
     static constexpr int camera_speed_ = 8;
 
+    /**
+     * @brief Copia los píxeles no transparentes de una fila de colores al buffer de pintado.
+     *
+     * El píxel de la columna `x` es `colors[x - x0]` (o `colors[n - 1 - (x - x0)]` con `mirror`).
+     * Los tramos seguidos de píxeles no transparentes se copian de golpe.
+     *
+     * @pre `left`..`right` y `y` están dentro de la cámara y de la fila `x0`..`x0 + n - 1`.
+     */
+    void put_span_(int y, int left, int right, const int *colors, int x0, int n, bool mirror);
+
  public:
     /**
      * @brief Contruye una ventana con título, anchura y altura.
@@ -164,7 +189,8 @@ class Window {
      */
     ~Window() {
         fenster_close(&fenster_);
-        delete[] pixels_;
+        free_pixels(pixels_);
+        free_pixels(back_);
     }
 
     /**
@@ -192,9 +218,11 @@ class Window {
      * hasta el siguiente fotograma (en función de la velocidad de refresco, que suele ser de 60Hz,
      * lo que equivale a 16ms por fotograma).
      *
-     * `next_frame` hace todas estas cosas en una sola llamada. Además devuelve `false` cuando se ha
-     * clicado el botón de cerrar la ventana (típicamente arriba a la derecha, y con una "x"), de
-     * forma que se pueda saber si se debe continuar en un bucle de pintado de fotogramas.
+     * `next_frame` hace todas estas cosas en una sola llamada. Antes de mostrar el fotograma amplía
+     * el buffer de pintado según el `zoom` de la ventana (ver `upscale_pixels`). Además devuelve
+     * `false` cuando se ha clicado el botón de cerrar la ventana (típicamente arriba a la derecha,
+     * y con una "x"), de forma que se pueda saber si se debe continuar en un bucle de pintado de
+     * fotogramas.
      *
      * El uso típico es el siguiente:
      * ```c++
@@ -231,6 +259,8 @@ class Window {
      * `Colors`, como `red`, o bien poner un entero en hexadecimal, como 0x0084fb, que
      * equivale a los 3 valores RGB (o Red-Green-Blue) que conforman el color. Cualquier "color
      * picker" de la web suele mostrar el color hexadecimal en la notación `#0084fb` (de CSS).
+     *
+     * El relleno usa instrucciones SSE2 o AVX2 según la CPU (ver `fill_pixels`).
      */
     void clear(Color color = black);
 
@@ -373,7 +403,7 @@ class Window {
      * @returns El color del pixel en las coordenadas indicadas.
      */
     Color get_pixel(Pt xy) const {
-        return fenster_pixel(&fenster_, xy.x * zoom_, xy.y * zoom_);
+        return back_[xy.y * width() + xy.x];
     }
 
     /**
@@ -385,10 +415,63 @@ class Window {
      * fija, ya que el pintado podría llevar tanto tiempo que los fotogramas no se verían completos
      * en la pantalla durante los 16ms (a 60Hz) en que deben estar visibles.
      *
+     * El buffer tiene la resolución de la ventana sin zoom, así que cada llamada escribe un solo
+     * píxel, sea cual sea el `zoom`.
+     *
      * @param xy Coordenadas del pixel que se quiere cambiar
      * @param color Color que se quiere poner en el pixel indicado
      */
-    void set_pixel(Pt xy, Color color);
+    void set_pixel(Pt xy, Color color) {
+        const int x = xy.x - topleft_.x;
+        const int y = xy.y - topleft_.y;
+        const int w = width();
+        if (x >= 0 && x < w && y >= 0 && y < height()) {
+            back_[y * w + x] = color;
+        }
+    }
+
+    /**
+     * @brief Recorta un rectángulo a la parte que se ve en la cámara.
+     *
+     * @param rect Rectángulo en coordenadas del mundo, con los cuatro lados incluidos. Al volver
+     * contiene solo la parte visible.
+     * @returns `false` si no se ve ningún píxel del rectángulo.
+     */
+    bool clip(Rect& rect) const;
+
+    /**
+     * @brief Pinta una fila de píxeles a partir de un punto.
+     *
+     * Es equivalente a llamar a `set_pixel` para cada píxel, pero la fila se recorta contra la
+     * cámara una sola vez (y no se hace nada si no se ve) y los tramos de píxeles seguidos se
+     * copian directamente en el buffer.
+     *
+     * @param xy Coordenadas del primer píxel de la fila (el de más a la izquierda).
+     * @param colors Colores de los `n` píxeles. Los negativos son transparentes (no se pintan).
+     * @param n Número de píxeles.
+     * @param mirror Si la fila se pinta girada horizontalmente.
+     */
+    void blit_span(Pt xy, const int *colors, int n, bool mirror = false);
+
+    /**
+     * @brief Pinta una imagen (_sprite_) a partir de su esquina superior izquierda.
+     *
+     * La imagen se recorta contra la cámara una sola vez: si no se ve no se recorre, y si no solo
+     * se pintan sus filas visibles, como en `blit_span`.
+     *
+     * @param orig Esquina superior izquierda de la imagen.
+     * @param rows Filas de colores de la imagen (los negativos son transparentes).
+     * @param mirror Si la imagen se pinta girada horizontalmente.
+     */
+    void blit_rect(Pt orig, const std::vector<std::vector<int>>& rows, bool mirror = false);
+
+    /**
+     * @brief Rellena un rectángulo con un color.
+     *
+     * @param rect Rectángulo en coordenadas del mundo, con los cuatro lados incluidos.
+     * @param color Color de relleno.
+     */
+    void fill_rect(Rect rect, Color color);
 
     /**
      * @brief Cambia los FPS de refresco de la ventana.